@@ -0,0 +1,528 @@
+// Decode throughput of the bitread/ folder.
+// Build in Release and run e.g:
+//   bitread-bench --benchmark_out=bitread.json --benchmark_out_format=json
+// Every benchmark reports bytes_per_second (packed input) and time_per_word (in seconds) so that releases can be compared.
+#include "bitcursor.h"
+#include "bitfields.h"
+#include "bitread.h"
+#include "bitscan.h"
+#include "tb_checked_reader.h"
+#include "packed_reader.h"
+#include "tb_frame.h"
+#include "tb_reader.h"
+#include "tb_writer.h"
+#include "yuv422.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace
+{
+
+/// bitread as it used to be declared (virtual destructor), kept as a reference point
+template<typename buf_t>
+struct bitread_virtual
+{
+  buf_t buf;
+
+  bitread_virtual(buf_t b) : buf(b) {}
+  bitread_virtual(const bitread_virtual&) = default;
+  virtual ~bitread_virtual() = default;
+
+  template<typename T> inline T get(decltype(buf) idx, decltype(buf) sz) const
+  {
+    return static_cast<T>((((buf) & (((static_cast<decltype(buf)>(1) << (sz)) - static_cast<decltype(buf)>(1)) << (idx))) >> (idx)));
+  }
+};
+
+/// 10-bit 4:2:2 frame: 2 words per pixel
+struct frame_desc_t
+{
+  size_t width;
+  size_t height;
+
+  size_t line_words() const { return width * 2; }
+  size_t line_bytes() const { return line_words() * 10 / 8; }
+  size_t bytes() const { return line_bytes() * height; }
+};
+
+/// state.range(0) is the frame width, state.range(1) the frame height
+frame_desc_t frame_desc(const benchmark::State& state)
+{
+  return frame_desc_t{static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(1))};
+}
+
+const std::vector<uint8_t>& random_bytes(size_t sz)
+{
+  static std::vector<uint8_t> buf;
+  if (buf.size() < sz)
+  {
+    std::mt19937 rng(42);
+    buf.resize(sz);
+    for (auto& b : buf) b = static_cast<uint8_t>(rng());
+  }
+  return buf;
+}
+
+void set_counters(benchmark::State& state, size_t bytes, size_t words)
+{
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+  state.counters["time_per_word"] = benchmark::Counter(static_cast<double>(words), benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+}
+
+// 1080p & 2160p frames (a single line & a full frame)
+#define FRAME_ARGS ->Args({1920, 1})->Args({1920, 1080})->Args({3840, 1})->Args({3840, 2160})
+
+} // namespace
+
+// tb_reader ------------------------------------------------------------------
+
+static void tb_reader_random(benchmark::State& state)
+{
+  const auto f = frame_desc(state);
+  const auto& buf = random_bytes(f.bytes());
+  tb_reader r(buf.data());
+
+  // random word order across the whole frame
+  std::vector<uint32_t> idx(f.line_words() * f.height);
+  std::iota(idx.begin(), idx.end(), 0);
+  std::shuffle(idx.begin(), idx.end(), std::mt19937(1));
+
+  for (auto _ : state)
+  {
+    uint32_t sum = 0;
+    for (auto i : idx) sum += r[i];
+    benchmark::DoNotOptimize(sum);
+  }
+  set_counters(state, f.bytes(), idx.size());
+}
+BENCHMARK(tb_reader_random) FRAME_ARGS;
+
+static void tb_checked_reader_random(benchmark::State& state)
+{
+  const auto f = frame_desc(state);
+  const auto& buf = random_bytes(f.bytes());
+  tb_checked_reader r(buf.data(), f.bytes());
+
+  std::vector<uint32_t> idx(r.size());
+  std::iota(idx.begin(), idx.end(), 0);
+  std::shuffle(idx.begin(), idx.end(), std::mt19937(1));
+
+  for (auto _ : state)
+  {
+    uint32_t sum = 0;
+    for (auto i : idx) sum += r[i];
+    benchmark::DoNotOptimize(sum);
+  }
+  set_counters(state, f.bytes(), idx.size());
+}
+BENCHMARK(tb_checked_reader_random) FRAME_ARGS;
+
+static void tb_reader_sequential(benchmark::State& state)
+{
+  const auto f = frame_desc(state);
+  const auto& buf = random_bytes(f.bytes());
+  tb_reader r(buf.data());
+  const size_t n = f.line_words() * f.height;
+
+  for (auto _ : state)
+  {
+    uint32_t sum = 0;
+    for (size_t i=0; i < n; ++i) sum += r[i];
+    benchmark::DoNotOptimize(sum);
+  }
+  set_counters(state, f.bytes(), n);
+}
+BENCHMARK(tb_reader_sequential) FRAME_ARGS;
+
+static void tb_reader_range(benchmark::State& state)
+{
+  const auto f = frame_desc(state);
+  const auto& buf = random_bytes(f.bytes());
+  tb_reader r(buf.data());
+  const size_t n = f.line_words() * f.height;
+
+  for (auto _ : state)
+  {
+    uint32_t sum = 0;
+    for (uint16_t w : r.range(0, n)) sum += w;
+    benchmark::DoNotOptimize(sum);
+  }
+  set_counters(state, f.bytes(), n);
+}
+BENCHMARK(tb_reader_range) FRAME_ARGS;
+
+/// state.range(2) is the simd_level
+static void tb_reader_unpack(benchmark::State& state)
+{
+  const auto f = frame_desc(state);
+  const auto lvl = static_cast<simd_level>(state.range(2));
+  if (lvl > simd_detect())
+  {
+    state.SkipWithError("instruction set not supported by the host");
+    return;
+  }
+
+  const auto& buf = random_bytes(f.bytes());
+  std::vector<uint16_t> out(f.line_words() * f.height);
+
+  for (auto _ : state)
+  {
+    for (size_t l=0; l < f.height; ++l)
+    {
+      tb_reader(buf.data() + l * f.line_bytes()).unpack(out.data() + l * f.line_words(), 0, f.line_words(), lvl);
+    }
+    benchmark::ClobberMemory();
+  }
+  set_counters(state, f.bytes(), out.size());
+}
+BENCHMARK(tb_reader_unpack)->ArgsProduct({{1920, 3840}, {1, 1080}, {0, 1, 2, 3}})->ArgNames({"width", "height", "simd"});
+
+/// state.range(2) is the simd_level
+static void tb_writer_pack(benchmark::State& state)
+{
+  const auto f = frame_desc(state);
+  const auto lvl = static_cast<simd_level>(state.range(2));
+  if (lvl > simd_detect())
+  {
+    state.SkipWithError("instruction set not supported by the host");
+    return;
+  }
+
+  std::vector<uint16_t> in(f.line_words() * f.height);
+  std::mt19937 rng(1);
+  for (auto& w : in) w = static_cast<uint16_t>(rng() & 0x3ff);
+  std::vector<uint8_t> out(f.bytes());
+
+  for (auto _ : state)
+  {
+    for (size_t l=0; l < f.height; ++l)
+    {
+      tb_writer(out.data() + l * f.line_bytes()).pack(in.data() + l * f.line_words(), 0, f.line_words(), lvl);
+    }
+    benchmark::ClobberMemory();
+  }
+  set_counters(state, f.bytes(), in.size());
+}
+BENCHMARK(tb_writer_pack)->ArgsProduct({{1920, 3840}, {1, 1080}, {0, 1, 2, 3}})->ArgNames({"width", "height", "simd"});
+
+/// state.range(2) is the number of threads
+static void tb_frame_unpack(benchmark::State& state)
+{
+  const auto f = frame_desc(state);
+  const auto& buf = random_bytes(f.bytes());
+  std::vector<uint16_t> out(f.line_words() * f.height);
+  tb_frame_unpacker u(static_cast<unsigned>(state.range(2)));
+
+  for (auto _ : state)
+  {
+    u.unpack(buf.data(), tb_frame_desc::contiguous(f.line_words(), f.height), out.data());
+    benchmark::ClobberMemory();
+  }
+  set_counters(state, f.bytes(), out.size());
+}
+BENCHMARK(tb_frame_unpack)->Apply([](benchmark::internal::Benchmark* b)
+{
+  for (int t : {1, 2, 4, 8}) b->Args({1920, 1080, t})->Args({3840, 2160, t});
+})->ArgNames({"width", "height", "threads"})->UseRealTime();
+
+// yuv422 ---------------------------------------------------------------------
+
+/// Converts a v210 frame to planar, state.range(2) being the number of OpenMP threads
+static void yuv422_v210_to_planar(benchmark::State& state)
+{
+  const auto f = frame_desc(state);
+#ifdef _OPENMP
+  omp_set_num_threads(static_cast<int>(state.range(2)));
+#endif
+  const size_t stride = yuv422::v210::line_size(f.width);
+  const auto& src = random_bytes(stride * f.height);
+  std::vector<uint16_t> y(f.width * f.height), cb(f.width / 2 * f.height), cr(f.width / 2 * f.height);
+
+  const yuv422::frame_t<const uint8_t> s{{src.data(), nullptr, nullptr}, {stride, 0, 0}};
+  const yuv422::frame_t<uint8_t> d{{reinterpret_cast<uint8_t*>(y.data()), reinterpret_cast<uint8_t*>(cb.data()), reinterpret_cast<uint8_t*>(cr.data())},
+                                   {f.width * 2, f.width, f.width}};
+  for (auto _ : state)
+  {
+    yuv422::convert_frame<yuv422::v210, yuv422::planar>(s, d, f.width, f.height);
+    benchmark::ClobberMemory();
+  }
+  set_counters(state, stride * f.height, f.line_words() * f.height);
+#ifdef _OPENMP
+  omp_set_num_threads(omp_get_num_procs());
+#endif
+}
+BENCHMARK(yuv422_v210_to_planar)->Apply([](benchmark::internal::Benchmark* b)
+{
+  for (int t : {1, 2, 4, 8}) b->Args({1920, 1080, t})->Args({3840, 2160, t});
+})->ArgNames({"width", "height", "threads"})->UseRealTime();
+
+// packed_reader --------------------------------------------------------------
+
+template<unsigned Bits>
+static void packed_reader_unpack(benchmark::State& state)
+{
+  const auto f = frame_desc(state);
+  const size_t n = f.line_words() * f.height;
+  const size_t bytes = (n * Bits + 7) / 8;
+  const auto& buf = random_bytes(bytes);
+  packed_reader<Bits> r(buf.data(), bytes);
+  std::vector<typename packed_reader<Bits>::value_type> out(n);
+
+  for (auto _ : state)
+  {
+    r.unpack(out.data(), 0, n);
+    benchmark::ClobberMemory();
+  }
+  set_counters(state, bytes, n);
+}
+BENCHMARK_TEMPLATE(packed_reader_unpack, 10) FRAME_ARGS;
+BENCHMARK_TEMPLATE(packed_reader_unpack, 12) FRAME_ARGS;
+BENCHMARK_TEMPLATE(packed_reader_unpack, 20) FRAME_ARGS;
+
+// bitread --------------------------------------------------------------------
+
+/// Extracts a field from each of 1M integers of type R, state.range(0) being the field size
+template<typename R, typename buf_t>
+static void bitread_get(benchmark::State& state)
+{
+  const size_t n = 1 << 20;
+  const auto& bytes = random_bytes(n * sizeof(buf_t));
+  std::vector<R> v;
+  v.reserve(n);
+  for (size_t i=0; i < n; ++i) v.emplace_back(static_cast<buf_t>(bitread<buf_t>(bytes.data() + i * sizeof(buf_t), sizeof(buf_t)).buf));
+
+  const buf_t sz = static_cast<buf_t>(state.range(0));
+  for (auto _ : state)
+  {
+    uint64_t sum = 0;
+    for (const auto& b : v) sum += b.template get<uint64_t>(1, sz);
+    benchmark::DoNotOptimize(sum);
+  }
+  set_counters(state, n * sizeof(R), n);
+  state.counters["sizeof"] = sizeof(R);
+}
+BENCHMARK_TEMPLATE(bitread_get, bitread<uint8_t>, uint8_t)->Arg(4);
+BENCHMARK_TEMPLATE(bitread_get, bitread<uint16_t>, uint16_t)->Arg(4)->Arg(12);
+BENCHMARK_TEMPLATE(bitread_get, bitread<uint32_t>, uint32_t)->Arg(4)->Arg(12)->Arg(24);
+BENCHMARK_TEMPLATE(bitread_get, bitread<uint64_t>, uint64_t)->Arg(4)->Arg(12)->Arg(24)->Arg(48);
+BENCHMARK_TEMPLATE(bitread_get, bitread_virtual<uint32_t>, uint32_t)->Arg(12);
+
+/// Same as above, with compile-time field positions
+template<typename buf_t>
+static void bitread_get_static(benchmark::State& state)
+{
+  const size_t n = 1 << 20;
+  const auto& bytes = random_bytes(n * sizeof(buf_t));
+  std::vector<bitread<buf_t>> v;
+  v.reserve(n);
+  for (size_t i=0; i < n; ++i) v.emplace_back(bytes.data() + i * sizeof(buf_t), sizeof(buf_t));
+
+  for (auto _ : state)
+  {
+    uint64_t sum = 0;
+    for (const auto& b : v) sum += b.template get<uint64_t, 1, 4>();
+    benchmark::DoNotOptimize(sum);
+  }
+  set_counters(state, n * sizeof(buf_t), n);
+}
+BENCHMARK_TEMPLATE(bitread_get_static, uint16_t);
+BENCHMARK_TEMPLATE(bitread_get_static, uint64_t);
+
+// field_set ------------------------------------------------------------------
+
+namespace
+{
+
+// 6 fields of an MPEG-TS header: tei, pusi, prio, pid, afc, cc
+using ts_fields = field_set<uint32_t, bitfield<uint8_t,23,1>, bitfield<uint8_t,22,1>, bitfield<uint8_t,21,1>,
+                                      bitfield<uint16_t,8,13>, bitfield<uint8_t,4,2>, bitfield<uint8_t,0,4>>;
+
+// PES PTS & DTS, each split in 3 parts by marker bits (5 bytes each, in the 40 LSB of the buffer)
+using pes_fields = field_set<uint64_t, maskfield<uint64_t, 0x0e'fffe'fffe>>;
+
+struct ts_columns
+{
+  std::vector<uint8_t> tei, pusi, prio, afc, cc;
+  std::vector<uint16_t> pid;
+
+  explicit ts_columns(size_t n) : tei(n), pusi(n), prio(n), afc(n), cc(n), pid(n) {}
+  ts_fields::columns_t columns() { return {{tei.data(), pusi.data(), prio.data(), pid.data(), afc.data(), cc.data()}}; }
+};
+
+template<typename buf_t>
+std::vector<bitread<buf_t>> random_readers(size_t n)
+{
+  const auto& bytes = random_bytes(n * sizeof(buf_t));
+  std::vector<bitread<buf_t>> v;
+  v.reserve(n);
+  for (size_t i=0; i < n; ++i) v.emplace_back(bytes.data() + i * sizeof(buf_t), sizeof(buf_t));
+  return v;
+}
+
+} // namespace
+
+/// Reference: 6 calls to bitread::get per header, with runtime positions
+static void field_set_ts_bitread_get(benchmark::State& state)
+{
+  const size_t n = 1 << 16;
+  const auto v = random_readers<uint32_t>(n);
+  ts_columns c(n);
+
+  for (auto _ : state)
+  {
+    for (size_t i=0; i < n; ++i)
+    {
+      c.tei[i]  = v[i].get<uint8_t>(23, 1);
+      c.pusi[i] = v[i].get<uint8_t>(22, 1);
+      c.prio[i] = v[i].get<uint8_t>(21, 1);
+      c.pid[i]  = v[i].get<uint16_t>(8, 13);
+      c.afc[i]  = v[i].get<uint8_t>(4, 2);
+      c.cc[i]   = v[i].get<uint8_t>(0, 4);
+    }
+    benchmark::ClobberMemory();
+  }
+  set_counters(state, n * sizeof(uint32_t), n);
+}
+BENCHMARK(field_set_ts_bitread_get);
+
+/// state.range(0): 1 to extract with PEXT
+static void field_set_ts(benchmark::State& state)
+{
+  const bool bmi2 = state.range(0) != 0;
+  if (bmi2 && !cpu_bits_detect().bmi2)
+  {
+    state.SkipWithError("instruction set not supported by the host");
+    return;
+  }
+
+  const size_t n = 1 << 16;
+  const auto v = random_readers<uint32_t>(n);
+  ts_columns c(n);
+
+  for (auto _ : state)
+  {
+    ts_fields::get(v.data(), n, c.columns(), bmi2);
+    benchmark::ClobberMemory();
+  }
+  set_counters(state, n * sizeof(uint32_t), n);
+}
+BENCHMARK(field_set_ts)->Arg(0)->Arg(1)->ArgName("pext");
+
+/// state.range(0): 1 to extract with PEXT
+static void field_set_pts(benchmark::State& state)
+{
+  const bool bmi2 = state.range(0) != 0;
+  if (bmi2 && !cpu_bits_detect().bmi2)
+  {
+    state.SkipWithError("instruction set not supported by the host");
+    return;
+  }
+
+  const size_t n = 1 << 16;
+  const auto v = random_readers<uint64_t>(n);
+  std::vector<uint64_t> pts(n);
+
+  for (auto _ : state)
+  {
+    pes_fields::get(v.data(), n, {{pts.data()}}, bmi2);
+    benchmark::ClobberMemory();
+  }
+  set_counters(state, n * sizeof(uint64_t), n);
+}
+BENCHMARK(field_set_pts)->Arg(0)->Arg(1)->ArgName("pext");
+
+// bitscan --------------------------------------------------------------------
+
+/// Counts the set bits of a state.range(0) MB bitmap
+static void bitscan_count(benchmark::State& state)
+{
+  const size_t bytes = static_cast<size_t>(state.range(0)) << 20;
+  const auto& buf = random_bytes(bytes);
+
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(bitscan::count(buf.data(), 3, bytes * 8 - 5));
+  }
+  set_counters(state, bytes, bytes * 8);
+}
+BENCHMARK(bitscan_count)->Arg(1)->Arg(16);
+
+/// Visits every set bit of a state.range(0) MB bitmap holding one set bit per 4096 bits
+static void bitscan_find_next(benchmark::State& state)
+{
+  const size_t bytes = static_cast<size_t>(state.range(0)) << 20;
+  std::vector<uint8_t> buf(bytes, 0);
+  std::mt19937 rng(1);
+  for (size_t i=0; i < bytes; i += 512) buf[i + rng() % 512] = 0x10;
+
+  for (auto _ : state)
+  {
+    size_t n = 0;
+    for (size_t pos = bitscan::find_next(buf.data(), 0, bytes * 8); pos < bytes * 8; pos = bitscan::find_next(buf.data(), pos + 1, bytes * 8)) ++n;
+    benchmark::DoNotOptimize(n);
+  }
+  set_counters(state, bytes, bytes * 8);
+}
+BENCHMARK(bitscan_find_next)->Arg(1)->Arg(16);
+
+/// Extracts the MSB plane of a 2160p frame of Bits-wide samples
+template<unsigned Bits>
+static void bitscan_plane(benchmark::State& state)
+{
+  const size_t n = 3840 * 2 * 2160;
+  const auto& buf = random_bytes(n * Bits / 8);
+  std::vector<uint8_t> out(n / 8);
+
+  for (auto _ : state)
+  {
+    bitscan::plane<Bits>(buf.data(), 0, n, Bits - 1, out.data());
+    benchmark::ClobberMemory();
+  }
+  set_counters(state, n * Bits / 8, n);
+}
+BENCHMARK_TEMPLATE(bitscan_plane, 1);
+BENCHMARK_TEMPLATE(bitscan_plane, 10);
+BENCHMARK_TEMPLATE(bitscan_plane, 16);
+
+// bitcursor ------------------------------------------------------------------
+
+/// Decodes 1M ue(v) codes of small values (as found in parameter sets & slice headers)
+static void bitcursor_read_ue(benchmark::State& state)
+{
+  const size_t n = 1 << 20;
+  std::vector<uint8_t> buf(n * 4 + 8, 0);
+  size_t pos = 0;
+  std::mt19937 rng(1);
+  for (size_t i=0; i < n; ++i)
+  {
+    // ue(v) of v: (lz zeros) 1 (lz bits of v+1-2^lz)
+    const uint64_t x = (rng() % 64) + 1;
+    const unsigned lz = 63 - static_cast<unsigned>(__builtin_clzll(x));
+    pos += lz;
+    for (int b = static_cast<int>(lz); b >= 0; --b, ++pos)
+    {
+      if ((x >> b) & 1) buf[pos / 8] |= static_cast<uint8_t>(0x80 >> (pos % 8));
+    }
+  }
+
+  for (auto _ : state)
+  {
+    bitcursor c(buf.data(), buf.size());
+    uint64_t sum = 0;
+    for (size_t i=0; i < n; ++i) sum += c.read_ue();
+    benchmark::DoNotOptimize(sum);
+  }
+  set_counters(state, (pos + 7) / 8, n);
+}
+BENCHMARK(bitcursor_read_ue);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "bitread.h"
+#include "unaligned.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/// A named field of a bit_layout, Bits wide, decoded as a T.
+/// Fields are named by deriving from this struct: struct pid : field<13> {}; (a field appears at most once in a layout)
+template<size_t Bits, typename T=std::conditional_t<(Bits <= 8), uint8_t, std::conditional_t<(Bits <= 16), uint16_t, std::conditional_t<(Bits <= 32), uint32_t, uint64_t>>>>
+struct field
+{
+  static_assert(Bits >= 1 && Bits <= 64, "field size must be within [1;64] bits");
+
+  using value_type = T;
+  static constexpr size_t bits = Bits;
+};
+
+namespace bit_layout_detail
+{
+/// Number of occurrences of T in Ts
+template<typename T, typename... Ts>
+constexpr size_t count_of = (std::is_same<T, Ts>::value + ... + 0);
+}
+
+/**
+ * Declarative description of a header made of consecutive fields, stored MSB first (as read by bitread(const uint8_t*, size_t)).
+ * Layouts up to 64 bits are decoded from a single big-endian load, the fields being extracted with constant shifts.
+ * Larger layouts perform one load per field (fields must then be at most 57 bits wide).
+ * e.g:
+ * struct sync : field<8> {}; struct tei : field<1> {}; struct pusi : field<1> {}; struct prio : field<1> {}; struct pid : field<13> {};
+ * struct tsc : field<2> {};  struct afc : field<2> {}; struct cc : field<4> {};
+ * using ts_header = bit_layout<sync, tei, pusi, prio, pid, tsc, afc, cc>;
+ *
+ * auto h = ts_header::decode(pkt);
+ * h.get<pid>(); // -> 13-bit PID
+ */
+template<typename... Fields>
+struct bit_layout
+{
+  static_assert(sizeof...(Fields) > 0, "empty layout");
+  static_assert(((bit_layout_detail::count_of<Fields, Fields...> == 1) && ...), "fields are looked up by type: each one must appear once");
+
+  /// Size of the layout, in bits
+  static constexpr size_t bits = (Fields::bits + ...);
+  /// Size of the layout, in bytes (the last one may be partially used)
+  static constexpr size_t bytes = (bits + 7) / 8;
+
+  /// @returns the index of the field F in the layout
+  template<typename F> static constexpr size_t index()
+  {
+    constexpr bool match[] = {std::is_same<F, Fields>::value...};
+    for (size_t ii=0; ii < sizeof...(Fields); ++ii) if (match[ii]) return ii;
+    return sizeof...(Fields);
+  }
+
+  /// @returns the position of the first bit of the ith field, starting from the MSB of the first byte
+  static constexpr size_t offset(size_t i)
+  {
+    constexpr size_t w[] = {Fields::bits...};
+    size_t r = 0;
+    for (size_t ii=0; ii < i; ++ii) r += w[ii];
+    return r;
+  }
+
+  /// @returns the position of the first bit of the field F, starting from the MSB of the first byte
+  template<typename F> static constexpr size_t offset()
+  {
+    static_assert(index<F>() < sizeof...(Fields), "not a field of this layout");
+    return offset(index<F>());
+  }
+
+  /// bitread descriptor of the field F, when the layout is loaded in a buf_t (see bitread(const uint8_t*, size_t))
+  template<typename F, typename buf_t>
+  using bitfield_of = bitfield<typename F::value_type, sizeof(buf_t) * 8 - offset<F>() - F::bits, F::bits>;
+
+  /// Decoded values of every field
+  struct values_t
+  {
+    std::tuple<typename Fields::value_type...> v;
+
+    template<typename F> inline auto& get() { return std::get<index<F>()>(v); }
+    template<typename F> inline const auto& get() const { return std::get<index<F>()>(v); }
+  };
+
+  /// Destination of a batch decoding: one array per field (structure of arrays)
+  struct columns_t
+  {
+    std::tuple<typename Fields::value_type*...> v;
+
+    template<typename F> inline auto* get() const { return std::get<index<F>()>(v); }
+  };
+
+  /// Decodes every field of the header starting at p (which must hold at least bytes bytes)
+  static inline values_t decode(const uint8_t* p)
+  {
+    values_t r;
+    decode(p, r, std::index_sequence_for<Fields...>{});
+    return r;
+  }
+
+  /// Decodes every field from a bitread, the layout starting on its MSB
+  template<typename buf_t>
+  static inline values_t decode(const bitread<buf_t>& b)
+  {
+    static_assert(bits <= sizeof(buf_t) * 8, "layout does not fit in the buffer");
+    return values_t{std::make_tuple(b.get(bitfield_of<Fields, buf_t>{})...)};
+  }
+
+  /// Encodes every field of the header at p. Bits following the layout in its last byte are left untouched.
+  static inline void encode(const values_t& v, uint8_t* p)
+  {
+    encode(v, p, std::index_sequence_for<Fields...>{});
+  }
+
+  /// Decodes n headers, the ith one starting at p + i * stride, into one array per field.
+  /// e.g:
+  /// std::vector<uint16_t> pids(n); std::vector<uint8_t> ccs(n); ...
+  /// ts_header::decode(buf, 188, n, {{..., pids.data(), ..., ccs.data()}});
+  static inline void decode(const uint8_t* p, size_t stride, size_t n, const columns_t& out)
+  {
+    for (size_t ii=0; ii < n; ++ii, p += stride)
+    {
+      decode(p, ii, out, std::index_sequence_for<Fields...>{});
+    }
+  }
+
+private:
+  /// mask of the ith field, aligned on the LSB
+  template<size_t I> static constexpr uint64_t mask()
+  {
+    constexpr size_t w = std::tuple_element_t<I, std::tuple<Fields...>>::bits;
+    return w == 64 ? ~static_cast<uint64_t>(0) : (static_cast<uint64_t>(1) << (w % 64)) - 1;
+  }
+
+  /// @returns the ith field of the header at p, w being the first 8 bytes of the header when it fits in 64 bits
+  template<size_t I> static inline uint64_t extract(const uint8_t* p, uint64_t w)
+  {
+    constexpr size_t off = offset(I);
+    constexpr size_t sz = std::tuple_element_t<I, std::tuple<Fields...>>::bits;
+
+    if constexpr (bits <= 64)
+    {
+      return (w >> (64 - off - sz)) & mask<I>();
+    }
+    else
+    {
+      static_assert(sz <= 57, "fields of layouts larger than 64 bits must be at most 57 bits wide");
+      return (load_be<(off % 8 + sz + 7) / 8>(p + off / 8) >> (64 - off % 8 - sz)) & mask<I>();
+    }
+  }
+
+  template<size_t... I>
+  static inline void decode(const uint8_t* p, values_t& r, std::index_sequence<I...>)
+  {
+    const uint64_t w = load_be<(bytes < 8 ? bytes : 8)>(p);
+    ((std::get<I>(r.v) = static_cast<std::tuple_element_t<I, decltype(r.v)>>(extract<I>(p, w))), ...);
+  }
+
+  template<size_t... I>
+  static inline void decode(const uint8_t* p, size_t ii, const columns_t& out, std::index_sequence<I...>)
+  {
+    const uint64_t w = load_be<(bytes < 8 ? bytes : 8)>(p);
+    ((std::get<I>(out.v)[ii] = static_cast<std::remove_pointer_t<std::tuple_element_t<I, decltype(out.v)>>>(extract<I>(p, w))), ...);
+  }
+
+  template<size_t... I>
+  static inline void encode(const values_t& v, uint8_t* p, std::index_sequence<I...>)
+  {
+    if constexpr (bits <= 64)
+    {
+      // keep the bits following the layout
+      uint64_t w = load_be<bytes>(p) & (bits == 64 ? 0 : (~static_cast<uint64_t>(0) >> (bits % 64)));
+      ((w |= (static_cast<uint64_t>(std::get<I>(v.v)) & mask<I>()) << (64 - offset(I) - std::tuple_element_t<I, std::tuple<Fields...>>::bits)), ...);
+      store_be<bytes>(p, w);
+    }
+    else
+    {
+      (encode_field<I>(static_cast<uint64_t>(std::get<I>(v.v)), p), ...);
+    }
+  }
+
+  /// read-modify-write of a single field, used for layouts larger than 64 bits
+  template<size_t I>
+  static inline void encode_field(uint64_t v, uint8_t* p)
+  {
+    constexpr size_t off = offset(I);
+    constexpr size_t sz = std::tuple_element_t<I, std::tuple<Fields...>>::bits;
+    constexpr size_t n = (off % 8 + sz + 7) / 8;
+    constexpr size_t sh = 64 - off % 8 - sz;
+
+    const uint64_t w = load_be<n>(p + off / 8);
+    store_be<n>(p + off / 8, (w & ~(mask<I>() << sh)) | ((v & mask<I>()) << sh));
+  }
+};
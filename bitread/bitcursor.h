@@ -0,0 +1,175 @@
+#pragma once
+
+#include "unaligned.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+
+/**
+ * Sequential reader of variable length codes (H.264/HEVC parameter sets & slice headers), bit 0 being the MSB of the first byte.
+ * The unread bits are kept in a 64-bit cache register (MSB aligned), refilled with a single unaligned load every 7 to 8 bytes:
+ *  . fixed-size reads are a shift of the cache,
+ *  . Exp-Golomb & unary codes count their leading zeros with a single clz instruction, their cost depending on codes rather than bits.
+ * Reading past the end of the buffer returns 0 bits and never accesses memory after it: check overrun() once the parsing is done.
+ * Emulation prevention bytes must have been removed beforehand (RBSP).
+ * e.g:
+ * bitcursor c(sps, sps_sz);
+ * auto profile_idc = c.read(8);
+ * c.skip(16);
+ * auto sps_id = c.read_ue();
+ */
+struct bitcursor
+{
+  /// Use the provided 8-bits buffer (of sz bytes) as a source and starts at the specified offset, in bits
+  inline bitcursor(const uint8_t* p, size_t sz, size_t offset=0)
+    : _buf(p), _buf_sz(sz)
+  {
+    reset(offset);
+  }
+  bitcursor(const bitcursor&) = default;
+  bitcursor(bitcursor&&) = default;
+  ~bitcursor() = default;
+  bitcursor& operator=(const bitcursor&) = default;
+  bitcursor& operator=(bitcursor&&) = default;
+
+  /// @returns the current position, in bits
+  inline size_t position() const { return _byte * 8 - _avail; }
+  /// @returns the size of the buffer, in bits
+  inline size_t bits() const { return _buf_sz * 8; }
+  /// @returns the number of bits left before the end of the buffer
+  inline size_t bits_left() const { return overrun() ? 0 : bits() - position(); }
+  /// @returns true if more bits were read than the buffer holds (or if a malformed code was met)
+  inline bool overrun() const { return position() > bits(); }
+
+  /// @returns true if the current position is a multiple of 8
+  inline bool byte_aligned() const { return position() % 8 == 0; }
+  /// Moves to the next byte boundary, if not already aligned
+  inline void align() { skip((8 - position() % 8) % 8); }
+
+  /// @returns the next n bits (0 to 32) without consuming them
+  inline uint32_t peek(unsigned n)
+  {
+    if (_avail < n) refill();
+    return n ? static_cast<uint32_t>(_cache >> (64 - n)) : 0;
+  }
+
+  /// Reads the next n bits (0 to 32)
+  inline uint32_t read(unsigned n)
+  {
+    const uint32_t r = peek(n);
+    consume(n);
+    return r;
+  }
+
+  /// Reads a single bit
+  inline bool read_flag()
+  {
+    return read(1) != 0;
+  }
+
+  /// Skips n bits
+  inline void skip(size_t n)
+  {
+    if (n < _avail) consume(static_cast<unsigned>(n));
+    else reset(position() + n);
+  }
+
+  /// Reads an unary code: the number of 0 bits preceding the next 1 bit (which is consumed as well)
+  inline uint32_t read_unary()
+  {
+    const size_t lz = leading_zeros();
+    consume(1);
+    return static_cast<uint32_t>(lz);
+  }
+
+  /// Reads an unsigned Exp-Golomb code, ue(v). Codes of more than 31 leading zeros are malformed: they return UINT32_MAX and set overrun().
+  inline uint32_t read_ue()
+  {
+    if (_avail <= 56) refill();
+
+    // fast path: the whole code is in the cache
+    const unsigned z = _cache ? static_cast<unsigned>(__builtin_clzll(_cache)) : 64;
+    if (2 * z + 1 <= _avail)
+    {
+      const uint32_t r = static_cast<uint32_t>(_cache >> (63 - 2 * z)) - 1;
+      consume(2 * z + 1);
+      return r;
+    }
+
+    const size_t lz = leading_zeros();
+    if (lz > 31)
+    {
+      reset(bits() + 1);
+      return std::numeric_limits<uint32_t>::max();
+    }
+    consume(1);
+    return static_cast<uint32_t>((static_cast<uint64_t>(1) << lz) - 1 + read(static_cast<unsigned>(lz)));
+  }
+
+  /// Reads a signed Exp-Golomb code, se(v)
+  inline int32_t read_se()
+  {
+    const uint32_t k = read_ue();
+    return (k & 1) ? static_cast<int32_t>((k >> 1) + 1) : -static_cast<int32_t>(k >> 1);
+  }
+
+private:
+  const uint8_t* _buf;
+  size_t _buf_sz;
+  size_t _byte    = 0; // next byte to load in the cache
+  uint64_t _cache = 0; // unread bits, MSB aligned
+  unsigned _avail = 0; // number of valid bits in _cache
+
+  /// Tops the cache up to at least 57 bits. Bits after the end of the buffer are loaded as 0.
+  /// Bits of the next partial byte may be loaded as well: since they are loaded again (with the same value) by the next refill, this is harmless.
+  inline void refill()
+  {
+    uint64_t w = 0;
+    if (_byte + 8 <= _buf_sz) w = load_be64(_buf + _byte);
+    else if (_byte < _buf_sz) w = load_be64_tail(_buf + _byte, _buf_sz - _byte);
+
+    _cache |= w >> _avail;
+    const unsigned n = (64 - _avail) / 8;
+    _byte += n;
+    _avail += n * 8;
+  }
+
+  /// Drops the n (< 64, <= _avail) next bits of the cache
+  inline void consume(unsigned n)
+  {
+    _cache <<= n;
+    _avail -= n;
+  }
+
+  /// Moves to the absolute bit position pos
+  inline void reset(size_t pos)
+  {
+    _byte = pos / 8;
+    _cache = 0;
+    _avail = 0;
+    refill();
+    consume(pos % 8);
+  }
+
+  /// Counts & consumes the 0 bits preceding the next 1 bit, which is left in the cache. Stops at the end of the buffer.
+  inline size_t leading_zeros()
+  {
+    size_t lz = 0;
+    for (;;)
+    {
+      if (_avail <= 56) refill();
+
+      const unsigned z = _cache ? static_cast<unsigned>(__builtin_clzll(_cache)) : 64;
+      if (z < _avail)
+      {
+        consume(z);
+        return lz + z;
+      }
+
+      lz += _avail;
+      skip(_avail);
+      if (position() >= bits()) return lz;
+    }
+  }
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "bitread.h"
+#include "simd.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Compile-time description of a field made of the bits set in Mask, which need not be contiguous, read as a T.
+ * The bits are packed in order, the lowest one of Mask becoming the LSB of the value.
+ * e.g: an MPEG PES timestamp, split in 3 parts by marker bits:
+ * using pts = maskfield<uint64_t, 0x0e'fffe'fffe>; // bits 33..35, 17..31 and 1..15 of the 5 bytes, held in the 40 LSB of the buffer
+ */
+template<typename T, uint64_t Mask>
+struct maskfield
+{
+  static_assert(Mask != 0, "empty field");
+
+  using value_type = T;
+  static constexpr uint64_t mask = Mask;
+};
+
+namespace bitfields_detail
+{
+
+/// Mask of a bitfield or of a maskfield, within a 64-bit buffer
+template<typename F> struct field_mask;
+
+template<typename T, size_t Idx, size_t Sz> struct field_mask<bitfield<T, Idx, Sz>>
+{
+  static_assert(Idx + Sz <= 64, "field does not fit in 64 bits");
+  static constexpr uint64_t value = (Sz == 64 ? ~static_cast<uint64_t>(0) : (static_cast<uint64_t>(1) << Sz) - 1) << Idx;
+};
+
+template<typename T, uint64_t Mask> struct field_mask<maskfield<T, Mask>>
+{
+  static constexpr uint64_t value = Mask;
+};
+
+/// Portable counterpart of PEXT for a mask known at compile time: one shift & mask per run of contiguous bits of Mask
+template<uint64_t Mask> constexpr uint64_t gather(uint64_t v)
+{
+  constexpr unsigned idx = static_cast<unsigned>(__builtin_ctzll(Mask));                     // first bit of the lowest run
+  constexpr uint64_t run = Mask >> idx;
+  constexpr unsigned sz  = ~run ? static_cast<unsigned>(__builtin_ctzll(~run)) : 64 - idx;    // size of the lowest run
+  constexpr uint64_t low = sz == 64 ? ~static_cast<uint64_t>(0) : (static_cast<uint64_t>(1) << sz) - 1;
+  constexpr uint64_t rest = Mask & ~(low << idx);
+
+  if constexpr (rest == 0) return (v >> idx) & low;
+  else return ((v >> idx) & low) | (gather<rest>(v) << sz);
+}
+
+/// @returns true if the bits of mask are contiguous
+constexpr bool contiguous(uint64_t mask)
+{
+  const uint64_t run = mask >> __builtin_ctzll(mask);
+  return (run & (run + 1)) == 0;
+}
+
+} // bitfields_detail
+
+/**
+ * Extracts several fields of a bitread at once. Fields are bitfield or maskfield descriptors, and may overlap.
+ * get() is the portable path: contiguous fields are a shift & a mask, scattered ones one shift & mask per run of bits.
+ * On BMI2 hosts, the batch get() extracts each scattered field with a single PEXT instruction, whatever the number of runs it is
+ * made of. Contiguous fields keep their shift & mask, which the compiler can vectorize across headers: sets made of contiguous
+ * fields only never take the BMI2 path.
+ * The instruction set is selected once per batch, the whole loop being compiled for it.
+ * e.g:
+ * using ts = field_set<uint32_t, bitfield<bool,22,1>, bitfield<uint16_t,8,13>, bitfield<uint8_t,0,4>>; // pusi, pid, cc
+ * auto [pusi, pid, cc] = ts::get(bitread<uint32_t>(hdr, 4));
+ * ts::get(headers.data(), headers.size(), {{pusis.data(), pids.data(), ccs.data()}});
+ */
+template<typename buf_t, typename... Fields>
+struct field_set
+{
+  static_assert(sizeof...(Fields) > 0, "empty field set");
+  static_assert(std::is_unsigned<buf_t>::value && sizeof(buf_t) <= 8, "buffer must be an unsigned integer of at most 64 bits");
+  static_assert((((bitfields_detail::field_mask<Fields>::value >> (sizeof(buf_t) * 8 - 1) >> 1) == 0) && ...), "field does not fit in the buffer");
+
+  /// Extracted values, in the order of Fields
+  using values_t = std::tuple<typename Fields::value_type...>;
+
+  /// Destination of a batch extraction: one array per field (structure of arrays)
+  struct columns_t
+  {
+    std::tuple<typename Fields::value_type*...> v;
+  };
+
+  /// Extracts every field of b
+  static constexpr values_t get(const bitread<buf_t>& b)
+  {
+    return values_t{static_cast<typename Fields::value_type>(bitfields_detail::gather<bitfields_detail::field_mask<Fields>::value>(b.buf))...};
+  }
+
+  /// Extracts every field of the n readers of in into out, with PEXT if bmi2 is set and the host supports it
+  static inline void get(const bitread<buf_t>* in, size_t n, const columns_t& out, bool bmi2)
+  {
+#ifdef BITREAD_X86
+    bmi2 = bmi2 && cpu_bits_detect().bmi2;
+    if (bmi2 && scattered) return get_bmi2(in, n, out, std::index_sequence_for<Fields...>{});
+#else
+    (void)bmi2;
+#endif
+    get_portable(in, n, out, std::index_sequence_for<Fields...>{});
+  }
+
+  /// Same as above, PEXT being used when supported by the host
+  static inline void get(const bitread<buf_t>* in, size_t n, const columns_t& out)
+  {
+    get(in, n, out, cpu_bits_detect().bmi2);
+  }
+
+private:
+  /// true if at least one field is made of several runs of bits, and thus benefits from PEXT
+  static constexpr bool scattered = (!bitfields_detail::contiguous(bitfields_detail::field_mask<Fields>::value) || ...);
+
+  template<size_t... I>
+  static inline void get_portable(const bitread<buf_t>* in, size_t n, const columns_t& out, std::index_sequence<I...>)
+  {
+    const auto cols = out.v; // local copy: byte stores could otherwise alias the pointers, reloaded at each iteration
+    for (size_t ii=0; ii < n; ++ii)
+    {
+      const uint64_t w = in[ii].buf;
+      ((std::get<I>(cols)[ii] = static_cast<typename Fields::value_type>(bitfields_detail::gather<bitfields_detail::field_mask<Fields>::value>(w))), ...);
+    }
+  }
+
+#ifdef BITREAD_X86
+  template<uint64_t Mask>
+  __attribute__((target("bmi2")))
+  static inline uint64_t pext(uint64_t w)
+  {
+    if constexpr (bitfields_detail::contiguous(Mask)) return bitfields_detail::gather<Mask>(w);
+    else return _pext_u64(w, Mask);
+  }
+
+  template<size_t... I>
+  __attribute__((target("bmi2")))
+  static inline void get_bmi2(const bitread<buf_t>* in, size_t n, const columns_t& out, std::index_sequence<I...>)
+  {
+    const auto cols = out.v; // local copy: byte stores could otherwise alias the pointers, reloaded at each iteration
+    for (size_t ii=0; ii < n; ++ii)
+    {
+      const uint64_t w = in[ii].buf;
+      ((std::get<I>(cols)[ii] = static_cast<typename Fields::value_type>(pext<bitfields_detail::field_mask<Fields>::value>(w))), ...);
+    }
+  }
+#endif
+};
@@ -1,11 +1,38 @@
+#pragma once
+
 #include <type_traits>
 
 #include <cstdint>
 #include <cstdlib>
 
+/**
+ * Compile-time description of a field of Sz bits starting at index Idx (starting from the most LSB), read as a T.
+ * Descriptors are empty literal types: they can be grouped in constexpr tables and passed to bitread::get to fold masks & shifts into immediates.
+ * e.g:
+ * constexpr struct { bitfield<uint8_t,12,4> version; bitfield<uint16_t,0,12> length; } hdr{};
+ * bitread<uint16_t> b(0x1234);
+ * b.get(hdr.version); // -> 0x1
+ */
+template<typename T, size_t Idx, size_t Sz>
+struct bitfield
+{
+  static_assert(Sz > 0, "empty field");
+
+  using value_type = T;
+  static constexpr size_t idx = Idx;
+  static constexpr size_t sz = Sz;
+
+  /// @returns the field mask, aligned on the LSB
+  template<typename buf_t> static constexpr buf_t mask()
+  {
+    return Sz >= sizeof(buf_t) * 8 ? static_cast<buf_t>(~static_cast<buf_t>(0)) : static_cast<buf_t>((static_cast<buf_t>(1) << Sz) - static_cast<buf_t>(1));
+  }
+};
+
 /**
  * Given a buffer stored onto n bits, this class allows reading a value starting at an arbitraty index (in bits) with an arbitrary size (in bits)
  * Based over: https://stackoverflow.com/questions/11815894/how-to-read-write-arbitrary-bits-in-c-c
+ * bitread is a trivially copyable value type, exactly as large as its buffer: it can be stored in packed arrays, copied with memcpy and passed in registers.
  */
 template<typename buf_t>
 struct bitread {
@@ -16,39 +43,60 @@ struct bitread {
   /// e.g:
   /// bitread<uint16_t> b(0b1111000000001111);
   /// b.get<uint8_t>(2,4); // -> 0b0011
-  bitread(buf_t b)
+  constexpr bitread(buf_t b)
     : buf(b)
   {
     static_assert(std::is_integral<decltype(buf)>::value, "integral required");
   }
 
   /// Parses a char buffer and append each char in a single integer value.
+  /// Only the first sizeof(buf_t) bytes are read: use bitspan to read fields from larger buffers.
   /// e.g:
   /// uint8_t buf[2]; buf[0] = 0b11110000; buf[1] = 0b00001111;
   /// bitread<uint16_t> b(buf, 2); // b.buf == 0b1111000000001111
-  bitread(const uint8_t* p, size_t sz)
+  constexpr bitread(const uint8_t* p, size_t sz)
+    : buf(0)
   {
     static_assert(std::is_integral<decltype(buf)>::value, "integral required");
 
-    buf = 0;
-    for(size_t ii=0; ii < sz; ++ii)
+    for(size_t ii=0; ii < sz && ii < sizeof(decltype(buf)); ++ii)
     {
       buf |= static_cast<decltype(buf)>(p[ii]) << ((sizeof(decltype(buf)) - (1+ii)) * 8);
     }
   }
 
   bitread() = delete;
-  bitread(const bitread&) = default;
-  bitread(bitread&&) = default;
-  virtual ~bitread() = default;
+  constexpr bitread(const bitread&) = default;
+  constexpr bitread(bitread&&) = default;
+  ~bitread() = default;
+  bitread& operator=(const bitread&) = default;
+  bitread& operator=(bitread&&) = default;
 
   /// Fetch a value starting at index idx (starting from the most LSB) and reads up to sz bits
   /// e.g:
   /// uint8_t buf[2]; buf[0] = 0b11110000; buf[1] = 0b00001111;
   /// bitread<uint16_t> b(buf, 2); // b.buf == 0b1111000000001111
   /// b.get<uint8_t>(7,7); // -> 0b1100000
-  template<typename T> inline T get(decltype(buf) idx, decltype(buf) sz) const
+  template<typename T> constexpr T get(decltype(buf) idx, decltype(buf) sz) const
   {
     return static_cast<T>((((buf) & (((static_cast<decltype(buf)>(1) << (sz)) - static_cast<decltype(buf)>(1)) << (idx))) >> (idx)));
   }
+
+  /// Same as above, with the field position & size known at compile time. Fields must fit within buf.
+  /// e.g:
+  /// b.get<uint8_t,7,7>(); // -> 0b1100000
+  template<typename T, size_t Idx, size_t Sz> constexpr T get() const
+  {
+    static_assert(Idx + Sz <= sizeof(decltype(buf)) * 8, "field does not fit in the buffer");
+    return static_cast<T>((buf >> Idx) & bitfield<T,Idx,Sz>::template mask<decltype(buf)>());
+  }
+
+  /// Fetches the field described by a bitfield descriptor
+  template<typename T, size_t Idx, size_t Sz> constexpr T get(bitfield<T,Idx,Sz>) const
+  {
+    return get<T,Idx,Sz>();
+  }
 };
+
+static_assert(std::is_trivially_copyable<bitread<uint32_t>>::value, "bitread must remain trivially copyable");
+static_assert(sizeof(bitread<uint32_t>) == sizeof(uint32_t), "bitread must not carry more than its buffer");
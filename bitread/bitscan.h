@@ -0,0 +1,263 @@
+#pragma once
+
+#include "simd.h"
+#include "unaligned.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+/// Population count kernels used by bitscan::count: each returns the number of set bits of the n bytes at p.
+namespace bit_popcount
+{
+
+/// 8 bytes at a time (a libgcc call per word unless built with -mpopcnt).
+inline size_t scalar(const uint8_t* p, size_t n)
+{
+  size_t c = 0, i = 0;
+  for (; i + 8 <= n; i += 8) c += static_cast<size_t>(__builtin_popcountll(load_le64(p + i)));
+  for (; i < n; ++i) c += static_cast<size_t>(__builtin_popcount(p[i]));
+  return c;
+}
+
+#ifdef BITREAD_X86
+/// 32 bytes per iteration, spread over 4 independent counters to hide the latency of POPCNT.
+__attribute__((target("popcnt")))
+inline size_t popcnt(const uint8_t* p, size_t n)
+{
+  uint64_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32)
+  {
+    c0 += static_cast<uint64_t>(_mm_popcnt_u64(load_le64(p + i)));
+    c1 += static_cast<uint64_t>(_mm_popcnt_u64(load_le64(p + i + 8)));
+    c2 += static_cast<uint64_t>(_mm_popcnt_u64(load_le64(p + i + 16)));
+    c3 += static_cast<uint64_t>(_mm_popcnt_u64(load_le64(p + i + 24)));
+  }
+  for (; i + 8 <= n; i += 8) c0 += static_cast<uint64_t>(_mm_popcnt_u64(load_le64(p + i)));
+  for (; i < n; ++i) c0 += static_cast<uint64_t>(_mm_popcnt_u32(p[i]));
+  return static_cast<size_t>(c0 + c1 + c2 + c3);
+}
+
+/// 32 bytes per iteration: each nibble is counted through a 16-entry table lookup (byte shuffle), the byte counts being
+/// summed per 64-bit lane by a sum of absolute differences against 0.
+__attribute__((target("avx2,popcnt")))
+inline size_t avx2(const uint8_t* p, size_t n)
+{
+  const __m256i lut  = _mm256_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4, 0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+  const __m256i low  = _mm256_set1_epi8(0x0f);
+  __m256i acc = _mm256_setzero_si256();
+
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32)
+  {
+    const __m256i v  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+    const __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, low));
+    const __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+    acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+  }
+
+  const size_t c = static_cast<size_t>(_mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) +
+                                       _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3));
+  return c + popcnt(p + i, n - i);
+}
+#endif
+
+} // bit_popcount
+
+/**
+ * Scans of bitmaps (flag bitmaps, 1-bit alpha planes) and bit-plane extraction from packed samples.
+ * Positions are stream positions, as in bitspan: bit 0 is the MSB of the first byte. Ranges are [first; last[ and no function reads
+ * a byte that doesn't hold at least one bit of its range.
+ * Bitmaps are processed a 64-bit word (or a 256-bit vector) at a time, the fastest instructions supported by the host being
+ * selected at runtime (POPCNT, AVX2 and BMI2 PEXT). As bit 0 is a MSB, the first set bit of a word is found by counting its leading zeros.
+ */
+namespace bitscan
+{
+
+namespace detail
+{
+
+/// @returns the 8 bytes starting at byte as a big-endian value, bytes at or after end being read as 0
+inline uint64_t window(const uint8_t* p, size_t byte, size_t end)
+{
+  if (byte + 8 <= end) return load_be64(p + byte);
+  return byte < end ? load_be64_tail(p + byte, end - byte) : 0;
+}
+
+#ifdef BITREAD_X86
+/// @returns the first byte index from byte which starts a non-zero 32-byte block, or which is less than 32 bytes before end
+__attribute__((target("avx2")))
+inline size_t skip_zeros_avx2(const uint8_t* p, size_t byte, size_t end)
+{
+  for (; byte + 32 <= end; byte += 32)
+  {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + byte));
+    if (!_mm256_testz_si256(v, v)) break;
+  }
+  return byte;
+}
+#endif
+
+/// Gathers the bit k of the S Bits-wide samples at the top of w into the S LSB of the result, one shift per sample
+template<unsigned Bits, unsigned S>
+struct plane_gather
+{
+  unsigned k;
+
+  inline uint64_t operator()(uint64_t w) const
+  {
+    w <<= Bits - 1 - k; // bit k of each sample on top of it
+    uint64_t v = 0;
+    for (unsigned j=0; j < S; ++j) v = (v << 1) | ((w >> (63 - j * Bits)) & 1);
+    return v;
+  }
+};
+
+#ifdef BITREAD_X86
+/// Same as above, with a single PEXT
+struct plane_gather_bmi2
+{
+  uint64_t mask;
+
+  template<unsigned Bits, unsigned S> static inline plane_gather_bmi2 make(unsigned k)
+  {
+    uint64_t m = 0;
+    for (unsigned j=0; j < S; ++j) m |= static_cast<uint64_t>(1) << (63 - j * Bits - (Bits - 1 - k));
+    return plane_gather_bmi2{m};
+  }
+
+  __attribute__((target("bmi2")))
+  inline uint64_t operator()(uint64_t w) const
+  {
+    return _pext_u64(w, mask);
+  }
+};
+#endif
+
+/// Body of bitscan::plane, S samples per load. It is inlined in the BMI2 kernel below so that PEXT is inlined as well.
+template<unsigned Bits, unsigned S, typename Gather>
+__attribute__((always_inline))
+inline void plane(const uint8_t* p, size_t first, size_t count, uint8_t* out, Gather gather)
+{
+  const size_t end = ((first + count) * Bits + 7) / 8; // bytes holding the samples
+  size_t pos = first * Bits;
+
+  uint64_t acc = 0;  // pending output bits, MSB aligned
+  unsigned nacc = 0; // number of pending output bits (< 32 between iterations)
+  auto push = [&](uint64_t v, unsigned s)
+  {
+    acc |= v << (64 - nacc - s);
+    nacc += s;
+    if (nacc >= 32)
+    {
+      store_be<4>(out, acc);
+      out += 4;
+      acc <<= 32;
+      nacc -= 32;
+    }
+  };
+
+  size_t i = 0;
+
+  // body: whole 8-byte windows
+  for (; i + S <= count && pos / 8 + 8 <= end; i += S, pos += S * Bits)
+  {
+    push(gather(load_be64(p + pos / 8) << (pos % 8)), S);
+  }
+
+  // tail: the last samples, read byte per byte
+  for (; i < count; )
+  {
+    const unsigned s = static_cast<unsigned>(std::min<size_t>(S, count - i));
+    push(gather(window(p, pos / 8, end) << (pos % 8)) >> (S - s), s); // keeps the first s samples
+    i += s;
+    pos += static_cast<size_t>(s) * Bits;
+  }
+
+  // flush, clearing the unused bits of the last byte
+  for (; nacc > 0; nacc = nacc > 8 ? nacc - 8 : 0, acc <<= 8)
+  {
+    *out++ = static_cast<uint8_t>(acc >> 56);
+  }
+}
+
+#ifdef BITREAD_X86
+template<unsigned Bits, unsigned S>
+__attribute__((target("bmi2")))
+inline void plane_bmi2(const uint8_t* p, size_t first, size_t count, unsigned k, uint8_t* out)
+{
+  plane<Bits, S>(p, first, count, out, plane_gather_bmi2::make<Bits, S>(k));
+}
+#endif
+
+} // detail
+
+/// @returns the number of set bits of the range [first; last[ of the bitmap p
+inline size_t count(const uint8_t* p, size_t first, size_t last)
+{
+  if (first >= last) return 0;
+
+  const size_t fb = first / 8;
+  const size_t lb = last / 8;
+  const uint8_t head = static_cast<uint8_t>(0xff >> (first % 8));        // bits of the first byte within the range
+  const uint8_t tail = static_cast<uint8_t>(~(0xff >> (last % 8)));      // bits of the last byte within the range
+  if (fb == lb) return static_cast<size_t>(__builtin_popcount(p[fb] & head & tail));
+
+  size_t c = static_cast<size_t>(__builtin_popcount(p[fb] & head));
+  if (last % 8) c += static_cast<size_t>(__builtin_popcount(p[lb] & tail));
+
+  const uint8_t* body = p + fb + 1;
+  const size_t n = lb - fb - 1;
+#ifdef BITREAD_X86
+  if (simd_detect() >= simd_level::avx2 && cpu_bits_detect().popcnt) return c + bit_popcount::avx2(body, n);
+  if (cpu_bits_detect().popcnt) return c + bit_popcount::popcnt(body, n);
+#endif
+  return c + bit_popcount::scalar(body, n);
+}
+
+/// @returns the position of the first set bit of the range [first; last[ of the bitmap p, last if there is none
+inline size_t find_next(const uint8_t* p, size_t first, size_t last)
+{
+  if (first >= last) return last;
+
+  const size_t end = (last + 7) / 8;
+  size_t byte = first / 8;
+  uint64_t w = detail::window(p, byte, end) & (~static_cast<uint64_t>(0) >> (first % 8));
+
+#ifdef BITREAD_X86
+  const bool avx2 = simd_detect() >= simd_level::avx2;
+#endif
+  while (!w)
+  {
+    byte += 8;
+    if (byte >= end) return last;
+#ifdef BITREAD_X86
+    // sparse bitmaps: skip blocks of 256 zero bits at once
+    if (avx2) byte = detail::skip_zeros_avx2(p, byte, end);
+#endif
+    w = detail::window(p, byte, end);
+  }
+
+  // bits after last may be set in the last byte
+  return std::min(byte * 8 + static_cast<size_t>(__builtin_clzll(w)), last);
+}
+
+/// Extracts the bit k (0 being the LSB, k < Bits) of count consecutive Bits-wide samples (packed MSB first, as read by packed_reader<Bits>),
+/// starting at the sample index first, into the bitmap out: ((count + 7) / 8 bytes, the unused bits of the last byte being cleared).
+/// Each 64-bit load yields up to 32 samples, whose bits k are gathered with a single PEXT on BMI2 hosts.
+template<unsigned Bits>
+inline void plane(const uint8_t* p, size_t first, size_t count, unsigned k, uint8_t* out)
+{
+  static_assert(Bits >= 1 && Bits <= 32, "sample size must be within [1;32] bits");
+
+  // samples per load: a window shifted by up to 7 bits holds 57 usable bits, and at most 32 bits are flushed per iteration
+  constexpr unsigned S = std::min(32u, 57u / Bits);
+
+#ifdef BITREAD_X86
+  if (cpu_bits_detect().bmi2) return detail::plane_bmi2<Bits, S>(p, first, count, k, out);
+#endif
+  detail::plane<Bits, S>(p, first, count, out, detail::plane_gather<Bits, S>{k});
+}
+
+} // bitscan
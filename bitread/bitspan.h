@@ -0,0 +1,73 @@
+#pragma once
+
+#include "bitread.h"
+#include "unaligned.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+
+/**
+ * Reads bit fields anywhere in a byte buffer of arbitrary length, without copying it into an integer first.
+ * Unlike bitread, positions are stream positions: bit 0 is the MSB of the first byte.
+ * Each access is a single unaligned big-endian 64-bit load (two for fields crossing a 64-bit window). Loads never go past the end
+ * of the buffer: the last 7 bytes are fetched byte per byte and bits located after the end are read as 0.
+ * e.g:
+ * bitspan pkt(ts_packet, 188);
+ * pkt.get<uint16_t>(11, 13); // -> PID
+ */
+struct bitspan
+{
+  const uint8_t* buf;
+  size_t buf_sz;
+
+  /// Use the provided 8-bits buffer (of sz bytes) as a source
+  constexpr bitspan(const uint8_t* p, size_t sz)
+    : buf(p), buf_sz(sz) {}
+  constexpr bitspan(const bitspan&) = default;
+  constexpr bitspan(bitspan&&) = default;
+  ~bitspan() = default;
+  bitspan& operator=(const bitspan&) = default;
+  bitspan& operator=(bitspan&&) = default;
+
+  /// @returns the size of the buffer, in bits
+  constexpr size_t bits() const { return buf_sz * 8; }
+
+  /// Fetches sz bits (0 to 64) starting at the bit position pos. An empty field (sz == 0) reads as 0.
+  template<typename T> inline T get(size_t pos, size_t sz) const
+  {
+    if (sz == 0) return 0; // w >> 64 is undefined
+
+    const size_t byte = pos / 8;
+    const unsigned sh = pos % 8;
+
+    uint64_t w = window(byte) << sh;
+    if (sh + sz > 64)
+    {
+      // the field crosses the 64-bit window: complete it with the next byte
+      w |= static_cast<uint64_t>(byte + 8 < buf_sz ? buf[byte + 8] : 0) >> (8 - sh);
+    }
+    return static_cast<T>(w >> (64 - sz));
+  }
+
+  /// Same as above, with the field position & size known at compile time
+  template<typename T, size_t Pos, size_t Sz> inline T get() const
+  {
+    static_assert(Sz >= 1 && Sz <= 64, "field size must be within [1;64] bits");
+    return get<T>(Pos, Sz);
+  }
+
+  /// @returns the sizeof(buf_t) * 8 bits starting at pos as a bitread, for field extraction relative to pos
+  template<typename buf_t> inline bitread<buf_t> at(size_t pos) const
+  {
+    return bitread<buf_t>(get<buf_t>(pos, sizeof(buf_t) * 8));
+  }
+
+private:
+  /// @returns the 8 bytes starting at byte as a big-endian value
+  inline uint64_t window(size_t byte) const
+  {
+    if (byte + 8 <= buf_sz) return load_be64(buf + byte);
+    return byte < buf_sz ? load_be64_tail(buf + byte, buf_sz - byte) : 0;
+  }
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <type_traits>
+
+#include <cstdint>
+#include <cstdlib>
+
+/**
+ * Counterpart of bitread: given a buffer stored onto n bits, this class allows writing a value starting at an arbitraty index (in bits) with an arbitrary size (in bits)
+ */
+template<typename buf_t>
+struct bitwrite {
+  /// Data buffer (must be integral, data size depends on the template parameter)
+  buf_t buf;
+
+  /// Creates a writer from an initial value
+  /// e.g:
+  /// bitwrite<uint16_t> b(0);
+  /// b.set(2,4,0b0011); // b.buf == 0b0000000000001100
+  bitwrite(buf_t b=0)
+    : buf(b)
+  {
+    static_assert(std::is_integral<decltype(buf)>::value, "integral required");
+  }
+
+  bitwrite(const bitwrite&) = default;
+  bitwrite(bitwrite&&) = default;
+  ~bitwrite() = default;
+
+  /// Stores the sz first bits of v at index idx (starting from the most LSB), leaving other bits untouched
+  /// e.g:
+  /// bitwrite<uint16_t> b(0b1111000000001111);
+  /// b.set(7,7,0b1100000); // b.buf == 0b1111000000001111
+  template<typename T> inline bitwrite& set(decltype(buf) idx, decltype(buf) sz, T v)
+  {
+    const decltype(buf) m = ((static_cast<decltype(buf)>(1) << (sz)) - static_cast<decltype(buf)>(1)) << (idx);
+    buf = (buf & ~m) | ((static_cast<decltype(buf)>(v) << (idx)) & m);
+    return *this;
+  }
+
+  /// Writes the value in a char buffer, MSB first: this is the reverse operation of bitread(const uint8_t*, size_t)
+  /// e.g:
+  /// bitwrite<uint16_t> b(0b1111000000001111);
+  /// uint8_t buf[2]; b.store(buf, 2); // buf[0] == 0b11110000, buf[1] == 0b00001111
+  void store(uint8_t* p, size_t sz) const
+  {
+    for(size_t ii=0; ii < sz && ii < sizeof(decltype(buf)); ++ii)
+    {
+      p[ii] = static_cast<uint8_t>(buf >> ((sizeof(decltype(buf)) - (1+ii)) * 8));
+    }
+  }
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "unaligned.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+
+/// Order in which the bits of a packed stream are laid out in its bytes.
+enum class bit_order
+{
+  /// The first word starts on the MSB of the first byte and words are stored MSB first (e.g: tb_reader, SDI payloads).
+  msb_first,
+  /// The first word starts on the LSB of the first byte and words are stored LSB first (e.g: v210-like little-endian packing).
+  lsb_first,
+};
+
+/**
+ * Parses Bits-wide words (1 to 32) from a source 8-bits buffer of arbitrary length.
+ * This is the generic counterpart of tb_reader: packed_reader<10> reads the same layout.
+ * Each access performs a single unaligned 64-bit load (a word spans at most 39 bits once aligned on its first byte),
+ * the last 7 bytes of the buffer being fetched byte per byte so that the reader never goes past buf_sz.
+ * e.g:
+ * packed_reader<12> r(buf, sz);
+ * uint16_t w = r[3]; // bits 36 to 47
+ */
+template<unsigned Bits, bit_order Order=bit_order::msb_first>
+struct packed_reader
+{
+  static_assert(Bits >= 1 && Bits <= 32, "word size must be within [1;32] bits");
+
+  /// Smallest unsigned integer able to hold a word
+  using value_type = std::conditional_t<(Bits <= 8), uint8_t, std::conditional_t<(Bits <= 16), uint16_t, uint32_t>>;
+
+  /// Word size, in bits
+  static constexpr unsigned bits = Bits;
+  /// Mask of a word inside a 64-bit register
+  static constexpr uint64_t mask = (static_cast<uint64_t>(1) << Bits) - 1;
+
+  const uint8_t* buf;
+  size_t buf_sz;
+  size_t buf_off;
+
+  /// Use the provided 8-bits buffer (of sz bytes) as a source and starts at the specified offset, in bits
+  inline packed_reader(const uint8_t* buf, size_t sz, size_t offset=0): buf(buf), buf_sz(sz), buf_off(offset) {}
+  packed_reader(const packed_reader&) = default;
+  packed_reader(packed_reader&&) = default;
+  ~packed_reader() = default;
+
+  /// @returns the number of complete words held by the buffer
+  inline size_t size() const
+  {
+    return buf_sz * 8 > buf_off ? (buf_sz * 8 - buf_off) / Bits : 0;
+  }
+
+  /// Fetches the nth word from the buffer
+  inline value_type operator[](size_t i) const
+  {
+    size_t pos = buf_off + i * Bits;
+    return extract(window(pos / 8), pos % 8);
+  }
+
+  /// Decodes count consecutive words, starting at the word index first, into out.
+  /// Every 64-bit load serves as many words as it fully holds (e.g: 4 words of 12 bits) before being refilled.
+  inline void unpack(value_type* out, size_t first, size_t count) const
+  {
+    size_t pos = buf_off + first * Bits;
+
+    while (count)
+    {
+      const uint64_t w = window(pos / 8);
+      unsigned sh = pos % 8;
+
+      // at least 57 bits of the window are usable
+      for (; count && sh + Bits <= 64; --count, sh += Bits, pos += Bits)
+      {
+        *out++ = extract(w, sh);
+      }
+    }
+  }
+
+private:
+  /// @returns the 8 bytes starting at byte, in stream order
+  inline uint64_t window(size_t byte) const
+  {
+    if (byte + 8 <= buf_sz)
+    {
+      return Order == bit_order::msb_first ? load_be64(buf + byte) : load_le64(buf + byte);
+    }
+
+    const size_t n = byte < buf_sz ? buf_sz - byte : 0;
+    return Order == bit_order::msb_first ? load_be64_tail(buf + byte, n) : load_le64_tail(buf + byte, n);
+  }
+
+  /// @returns the word starting sh bits after the beginning of w
+  static inline value_type extract(uint64_t w, unsigned sh)
+  {
+    if (Order == bit_order::msb_first)
+    {
+      return static_cast<value_type>((w >> (64 - Bits - sh)) & mask);
+    }
+    return static_cast<value_type>((w >> sh) & mask);
+  }
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BITREAD_X86 1
+#endif
+
+/// Instruction sets the bulk kernels of this folder can be dispatched to, from the least to the most capable.
+enum class simd_level
+{
+  scalar,
+  ssse3,
+  avx2,
+  avx512, // AVX-512 F + BW
+};
+
+/// @returns the most capable instruction set supported by the host CPU (detected once through CPUID).
+inline simd_level simd_detect()
+{
+  static const simd_level lvl = []()
+  {
+#ifdef BITREAD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) return simd_level::avx512;
+    if (__builtin_cpu_supports("avx2")) return simd_level::avx2;
+    if (__builtin_cpu_supports("ssse3")) return simd_level::ssse3;
+#endif
+    return simd_level::scalar;
+  }();
+  return lvl;
+}
+
+/// Scalar bit manipulation instructions, detected once through CPUID independently of simd_level
+/// (e.g: some AVX2 hosts lack BMI2 and every x86-64-v2 host has POPCNT).
+struct cpu_bits
+{
+  bool popcnt = false;
+  bool bmi2   = false;
+};
+
+/// @returns the scalar bit manipulation instructions supported by the host CPU
+inline const cpu_bits& cpu_bits_detect()
+{
+  static const cpu_bits b = []()
+  {
+    cpu_bits r;
+#ifdef BITREAD_X86
+    __builtin_cpu_init();
+    r.popcnt = __builtin_cpu_supports("popcnt");
+    r.bmi2   = __builtin_cpu_supports("bmi2");
+#endif
+    return r;
+  }();
+  return b;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "tb_reader.h"
+#include "unaligned.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+/**
+ * Length-aware counterpart of tb_reader, for buffers that can't be over-allocated (e.g: externally owned DMA buffers).
+ * It never reads a byte past buf_sz, yet keeps bounds checks out of the inner loops:
+ *  . operator[] reads the words of the body with a single unaligned 32-bit load, and only the words of the last 3 bytes go
+ *    through the byte per byte tail routine. The branch between both paths is taken the same way for all but the last words.
+ *  . bulk accesses (unpack, range) clamp the requested words to size() once, then run the unchecked tb_reader kernels which,
+ *    by design, only touch the bytes holding the requested words.
+ * e.g:
+ * tb_checked_reader r(dma_buf, dma_sz);
+ * size_t n = r.unpack(out, 0, 3840*2); // n < 3840*2 if the buffer is short
+ */
+struct tb_checked_reader
+{
+  const uint8_t* buf;
+  size_t buf_sz;
+  size_t buf_off;
+
+  /// Use the provided 8-bits buffer (of sz bytes) as a source and starts at the specified offset, in bits
+  inline tb_checked_reader(const uint8_t* buf, size_t sz, size_t offset=0): buf(buf), buf_sz(sz), buf_off(offset) {}
+  tb_checked_reader(const tb_checked_reader&) = default;
+  tb_checked_reader(tb_checked_reader&&) = default;
+  ~tb_checked_reader() = default;
+
+  /// @returns the number of complete words held by the buffer
+  inline size_t size() const
+  {
+    return buf_sz * 8 > buf_off ? (buf_sz * 8 - buf_off) / 10 : 0;
+  }
+
+  /// @returns the same buffer, without bounds
+  inline tb_reader unchecked() const { return tb_reader(buf, buf_off); }
+
+  /// Fetches the nth word (i < size()), starting from the leftmost bit
+  inline uint16_t operator[](size_t i) const
+  {
+    const size_t pos = buf_off + i * 10;
+    if (pos / 8 + 4 <= buf_sz)
+    {
+      // the word lies within the 17 first bits of the window
+      return static_cast<uint16_t>((load_be<4>(buf + pos / 8) >> (54 - pos % 8)) & 0b0000001111111111);
+    }
+    return tail(i);
+  }
+
+  /// Same as above, throws std::out_of_range if i >= size()
+  inline uint16_t at(size_t i) const
+  {
+    if (i >= size()) throw std::out_of_range{"tb_checked_reader: word " + std::to_string(i) + " is out of range (size: " + std::to_string(size()) + ")"};
+    return (*this)[i];
+  }
+
+  /// @returns the words [first; first+count[ that are held by the buffer, as a range to be iterated sequentially
+  inline tb_range range(size_t first, size_t count) const
+  {
+    return unchecked().range(first, clamp(first, count));
+  }
+
+  /// Decodes up to count consecutive words, starting at the word index first, into out.
+  /// @returns the number of decoded words: less than count if the buffer ends before
+  inline size_t unpack(uint16_t* out, size_t first, size_t count) const
+  {
+    return unpack(out, first, count, simd_detect());
+  }
+
+  /// Same as above, using at most the specified instruction set
+  inline size_t unpack(uint16_t* out, size_t first, size_t count, simd_level lvl) const
+  {
+    count = clamp(first, count);
+    unchecked().unpack(out, first, count, lvl);
+    return count;
+  }
+
+private:
+  /// @returns count, reduced so that [first; first+count[ is within [0; size()[
+  inline size_t clamp(size_t first, size_t count) const
+  {
+    const size_t n = size();
+    return first < n ? std::min(count, n - first) : 0;
+  }
+
+  /// Checked tail: reads the 2 or 3 bytes holding the word i (< size()) one by one
+  inline uint16_t tail(size_t i) const
+  {
+    return unchecked()[i];
+  }
+};
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "tb_reader.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Read-only, memory-mapped capture file made of fixed-size frames of packed 10-bit words (raw captures, optionally preceded by a header).
+ * Frames are read in place from the page cache: no copy into heap buffers is involved.
+ * The mapping is advised as sequential (aggressive read-ahead, pages dropped early) and as a huge-page candidate where the kernel
+ * supports it for file mappings. frame() also asks the kernel to start reading the next frame in the background, so that it is
+ * resident by the time it is decoded.
+ * e.g:
+ * tb_file cap("capture.raw", 3840*2*2160*10/8); // 2160p 4:2:2 frames
+ * for (size_t i=0; i < cap.frames(); ++i) cap.frame(i).unpack(out, 0, 3840*2*2160);
+ */
+class tb_file
+{
+public:
+  /// Maps the file at path, made of frames of frame_sz bytes starting at the byte offset header. Throws on failure.
+  inline tb_file(const std::string& path, size_t frame_sz, size_t header=0)
+    : _frame_sz(frame_sz), _header(header)
+  {
+    if (_frame_sz == 0) throw std::runtime_error{"Frame size must not be 0"};
+
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw std::runtime_error{"Failed to open " + path + " for reading: " + strerror(errno)};
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+      const int err = errno;
+      ::close(fd);
+      throw std::runtime_error{"Failed to stat " + path + ": " + strerror(err)};
+    }
+    _sz = static_cast<size_t>(st.st_size);
+
+    if (_sz > 0)
+    {
+      void* p = ::mmap(nullptr, _sz, PROT_READ, MAP_SHARED, fd, 0);
+      if (p == MAP_FAILED)
+      {
+        const int err = errno;
+        ::close(fd);
+        throw std::runtime_error{"Failed to map " + path + ": " + strerror(err)};
+      }
+      _buf = static_cast<const uint8_t*>(p);
+
+      // hints only: failures are not an error
+      ::madvise(p, _sz, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+      ::madvise(p, _sz, MADV_HUGEPAGE);
+#endif
+    }
+    // the mapping keeps its own reference on the file
+    ::close(fd);
+  }
+
+  tb_file(const tb_file&) = delete;
+  tb_file& operator=(const tb_file&) = delete;
+
+  inline tb_file(tb_file&& o) noexcept
+    : _buf(o._buf), _sz(o._sz), _frame_sz(o._frame_sz), _header(o._header)
+  {
+    o._buf = nullptr;
+    o._sz = 0;
+  }
+
+  inline tb_file& operator=(tb_file&& o) noexcept
+  {
+    if (this != &o)
+    {
+      unmap();
+      _buf = o._buf;
+      _sz = o._sz;
+      _frame_sz = o._frame_sz;
+      _header = o._header;
+      o._buf = nullptr;
+      o._sz = 0;
+    }
+    return *this;
+  }
+
+  inline ~tb_file() { unmap(); }
+
+  /// @returns the mapped file
+  inline const uint8_t* data() const { return _buf; }
+  /// @returns the size of the file, in bytes
+  inline size_t size() const { return _sz; }
+  /// @returns the size of a frame, in bytes
+  inline size_t frame_size() const { return _frame_sz; }
+  /// @returns the number of complete frames of the file
+  inline size_t frames() const { return _sz > _header ? (_sz - _header) / _frame_sz : 0; }
+
+  /// @returns the first byte of the frame i (< frames())
+  inline const uint8_t* frame_data(size_t i) const { return _buf + _header + i * _frame_sz; }
+
+  /// @returns a reader over the frame i (< frames()) and prefetches the frame i+1
+  inline tb_reader frame(size_t i) const
+  {
+    prefetch(i + 1);
+    return tb_reader(frame_data(i));
+  }
+
+  /// Asks the kernel to read the frame i in the background (ignored if i >= frames())
+  inline void prefetch(size_t i) const
+  {
+    advise(i, MADV_WILLNEED);
+  }
+
+  /// Tells the kernel that the frame i won't be read again soon: its pages leave the process' resident set
+  /// (they stay in the page cache). Useful to keep the footprint of a long replay bounded.
+  inline void release(size_t i) const
+  {
+    advise(i, MADV_DONTNEED);
+  }
+
+private:
+  const uint8_t* _buf = nullptr;
+  size_t _sz          = 0;
+  size_t _frame_sz;
+  size_t _header;
+
+  inline void unmap()
+  {
+    if (_buf) ::munmap(const_cast<uint8_t*>(_buf), _sz);
+    _buf = nullptr;
+  }
+
+  /// Applies advice to the pages of the frame i. madvise() requires a page-aligned start address.
+  inline void advise(size_t i, int advice) const
+  {
+    if (i >= frames()) return;
+
+    static const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const size_t begin = _header + i * _frame_sz;
+    const size_t end   = begin + _frame_sz;
+
+    // pages are only dropped if they lie entirely within the frame: the first & last ones may be shared with the neighbouring frames
+    const bool drop    = advice == MADV_DONTNEED;
+    const size_t first = (drop ? begin + page - 1 : begin) / page * page;
+    const size_t last  = drop ? end / page * page : end;
+    if (last > first) ::madvise(const_cast<uint8_t*>(_buf) + first, last - first, advice);
+  }
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "tb_reader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Memory layout of a frame of packed 10-bit lines and of its unpacked (16-bit words) counterpart
+struct tb_frame_desc
+{
+  size_t words;      // number of words per line
+  size_t lines;      // number of lines
+  size_t stride;     // distance between the first bytes of 2 consecutive packed lines, in bytes
+  size_t out_stride; // distance between the first words of 2 consecutive unpacked lines, in words
+
+  /// @returns the layout of lines that follow each other without padding (each line starting on a byte boundary)
+  static constexpr tb_frame_desc contiguous(size_t words, size_t lines)
+  {
+    return tb_frame_desc{words, lines, (words * 10 + 7) / 8, words};
+  }
+};
+
+/**
+ * Unpacks whole frames of 10-bit words with a pool of worker threads, created once and reused for every frame.
+ * Lines are handed out in chunks of consecutive lines, so that each thread reads & writes contiguous memory, and every line
+ * is decoded by tb_reader::unpack. The calling thread takes part in the work and unpack() returns once the frame is complete.
+ * A tb_frame_unpacker is meant to be driven by a single thread at a time.
+ * e.g:
+ * tb_frame_unpacker u;                                        // one thread per core
+ * u.unpack(src, tb_frame_desc::contiguous(3840*2, 2160), out); // 2160p 4:2:2
+ */
+class tb_frame_unpacker
+{
+public:
+  /// Starts threads - 1 workers (the calling thread being the last one)
+  inline explicit tb_frame_unpacker(unsigned threads = std::thread::hardware_concurrency())
+  {
+    for (unsigned t=1; t < threads; ++t) _workers.emplace_back([this]() { worker(); });
+  }
+
+  tb_frame_unpacker(const tb_frame_unpacker&) = delete;
+  tb_frame_unpacker& operator=(const tb_frame_unpacker&) = delete;
+
+  inline ~tb_frame_unpacker()
+  {
+    {
+      std::lock_guard<std::mutex> lk(_m);
+      _stop = true;
+    }
+    _start_cv.notify_all();
+    for (auto& w : _workers) w.join();
+  }
+
+  /// @returns the number of threads decoding a frame, the caller included
+  inline unsigned threads() const { return static_cast<unsigned>(_workers.size()) + 1; }
+
+  /// Decodes every line of the frame src (laid out as described by d) into out
+  inline void unpack(const uint8_t* src, const tb_frame_desc& d, uint16_t* out)
+  {
+    unpack(src, d, out, simd_detect());
+  }
+
+  /// Same as above, using at most the specified instruction set
+  inline void unpack(const uint8_t* src, const tb_frame_desc& d, uint16_t* out, simd_level lvl)
+  {
+    // ~4 chunks per thread balance the load without splitting the frame in tiny pieces
+    const job j{src, out, d, lvl, std::max<size_t>(1, d.lines / (threads() * 4))};
+    if (_workers.empty() || d.lines <= j.chunk)
+    {
+      lines(j, 0, d.lines);
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lk(_m);
+      _job = j;
+      _next.store(0, std::memory_order_relaxed);
+      _busy = static_cast<unsigned>(_workers.size());
+      ++_gen;
+    }
+    _start_cv.notify_all();
+
+    run(j);
+
+    // every worker must be done with this job before the next one resets _next
+    std::unique_lock<std::mutex> lk(_m);
+    _done_cv.wait(lk, [this]() { return _busy == 0; });
+  }
+
+private:
+  struct job
+  {
+    const uint8_t* src;
+    uint16_t* out;
+    tb_frame_desc desc;
+    simd_level lvl;
+    size_t chunk; // number of lines taken at once
+  };
+
+  std::vector<std::thread> _workers;
+  std::mutex _m;
+  std::condition_variable _start_cv;
+  std::condition_variable _done_cv;
+  job _job{};
+  uint64_t _gen  = 0;     // incremented for every frame handed to the workers
+  unsigned _busy = 0;     // number of workers still running the current job
+  bool _stop     = false;
+  std::atomic<size_t> _next{0}; // first line of the next chunk
+
+  /// Decodes chunks of lines until the frame is complete
+  inline void run(const job& j)
+  {
+    for (size_t first; (first = _next.fetch_add(j.chunk, std::memory_order_relaxed)) < j.desc.lines; )
+    {
+      lines(j, first, std::min(first + j.chunk, j.desc.lines));
+    }
+  }
+
+  /// Decodes the lines [first;last[
+  static inline void lines(const job& j, size_t first, size_t last)
+  {
+    for (size_t l=first; l < last; ++l)
+    {
+      tb_reader(j.src + l * j.desc.stride).unpack(j.out + l * j.desc.out_stride, 0, j.desc.words, j.lvl);
+    }
+  }
+
+  inline void worker()
+  {
+    uint64_t seen = 0;
+    for (;;)
+    {
+      job j;
+      {
+        std::unique_lock<std::mutex> lk(_m);
+        _start_cv.wait(lk, [&]() { return _stop || _gen != seen; });
+        if (_stop) return;
+        seen = _gen;
+        j = _job;
+      }
+
+      run(j);
+
+      std::lock_guard<std::mutex> lk(_m);
+      if (--_busy == 0) _done_cv.notify_one();
+    }
+  }
+};
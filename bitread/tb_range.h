@@ -0,0 +1,125 @@
+#pragma once
+
+#include "unaligned.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+
+/**
+ * Forward iterator over consecutive 10-bit words of a packed buffer (same layout as tb_reader).
+ * Instead of locating each word from its index, the iterator keeps the unread bits of the stream in a 64-bit cache register
+ * (MSB aligned) which is refilled with a single unaligned load every 5 to 6 words: reading a word is then a shift.
+ * Iterators are compared on their word index and never read past the end of the range they were created from.
+ */
+struct tb_iterator
+{
+  using iterator_category = std::forward_iterator_tag;
+  using value_type        = uint16_t;
+  using difference_type   = std::ptrdiff_t;
+  using pointer           = const uint16_t*;
+  using reference         = const uint16_t&;
+
+  /// Creates an iterator reading words from the bit position pos of buf, which holds its last readable byte right before end.
+  /// idx is the index of the first word, used to compare iterators.
+  inline tb_iterator(const uint8_t* buf, size_t pos, const uint8_t* end, size_t idx)
+    : _p(buf + pos / 8), _end(end), _idx(idx)
+  {
+    if (_p < _end)
+    {
+      refill();
+      _cache <<= pos % 8;
+      _avail -= pos % 8;
+      fetch();
+    }
+  }
+
+  /// Creates a past-the-end iterator
+  inline explicit tb_iterator(size_t idx)
+    : _idx(idx) {}
+
+  tb_iterator() = default;
+  tb_iterator(const tb_iterator&) = default;
+  tb_iterator(tb_iterator&&) = default;
+  ~tb_iterator() = default;
+  tb_iterator& operator=(const tb_iterator&) = default;
+  tb_iterator& operator=(tb_iterator&&) = default;
+
+  inline reference operator*() const { return _val; }
+  inline pointer operator->() const { return &_val; }
+
+  inline tb_iterator& operator++()
+  {
+    ++_idx;
+    fetch();
+    return *this;
+  }
+
+  inline tb_iterator operator++(int)
+  {
+    tb_iterator r = *this;
+    ++(*this);
+    return r;
+  }
+
+  inline bool operator==(const tb_iterator& o) const { return _idx == o._idx; }
+  inline bool operator!=(const tb_iterator& o) const { return _idx != o._idx; }
+
+  /// @returns the index of the current word
+  inline size_t index() const { return _idx; }
+
+private:
+  const uint8_t* _p   = nullptr; // next byte to load in the cache
+  const uint8_t* _end = nullptr; // end of the readable bytes
+  uint64_t _cache     = 0;       // unread bits, MSB aligned
+  unsigned _avail     = 0;       // number of valid bits in _cache
+  size_t _idx         = 0;       // index of the current word
+  uint16_t _val       = 0;       // current word
+
+  /// Tops the cache up with as many whole bytes as possible.
+  /// Bits of the next partial byte may be loaded as well: since they are loaded again (with the same value) by the next refill, this is harmless.
+  inline void refill()
+  {
+    const size_t left = _p < _end ? static_cast<size_t>(_end - _p) : 0;
+    _cache |= (left >= 8 ? load_be64(_p) : load_be64_tail(_p, left)) >> _avail;
+
+    const unsigned n = (64 - _avail) / 8;
+    _p += n;
+    _avail += n * 8;
+  }
+
+  /// Pops the next word out of the cache
+  inline void fetch()
+  {
+    if (_avail < 10) refill();
+    _val = static_cast<uint16_t>(_cache >> 54);
+    _cache <<= 10;
+    _avail -= 10;
+  }
+};
+
+/// A range of consecutive 10-bit words, usable in range-for loops and standard algorithms.
+/// e.g:
+/// for (uint16_t w : tb_reader(buf).range(0, 1920)) { ... }
+struct tb_range
+{
+  const uint8_t* buf;
+  size_t buf_off; // position of the first word, in bits
+  size_t first;   // index of the first word
+  size_t count;   // number of words
+
+  inline tb_iterator begin() const
+  {
+    if (count == 0) return end();
+    return tb_iterator{buf, buf_off, buf + (buf_off + count * 10 + 7) / 8, first};
+  }
+
+  inline tb_iterator end() const
+  {
+    return tb_iterator{first + count};
+  }
+
+  inline size_t size() const { return count; }
+  inline bool empty() const { return count == 0; }
+};
@@ -1,6 +1,98 @@
+#pragma once
+
+#include "simd.h"
+#include "tb_range.h"
+
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
 
+/// Bulk decoding kernels used by tb_reader::unpack.
+/// Every kernel expects a byte-aligned source (the first word starts on the MSB of p[0]), decodes groups of 4 words (5 bytes)
+/// and returns the number of words it decoded. Kernels never read past the last byte holding one of the n requested words.
+namespace tb_unpack
+{
+
+/// Decodes every complete group of 4 words, one group at a time.
+inline size_t scalar(const uint8_t* p, uint16_t* out, size_t n)
+{
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4, p += 5)
+  {
+    out[i]   = static_cast<uint16_t>((p[0] << 2) | (p[1] >> 6));
+    out[i+1] = static_cast<uint16_t>(((p[1] & 0b00111111) << 4) | (p[2] >> 4));
+    out[i+2] = static_cast<uint16_t>(((p[2] & 0b00001111) << 6) | (p[3] >> 2));
+    out[i+3] = static_cast<uint16_t>(((p[3] & 0b00000011) << 8) | p[4]);
+  }
+  return i;
+}
+
+#ifdef BITREAD_X86
+// The SIMD kernels share the same idea, applied on 10 source bytes (8 words) per 128-bit lane:
+//  . a byte shuffle gathers, in each 16-bit lane, the 2 bytes holding the word as a big-endian value (e.g: word 1 -> p[1]<<8 | p[2]).
+//  . the word sits at bit 6, 4, 2 or 0 in its lane: multiplying by 1, 4, 16 or 64 moves it on top of the lane (dropping the bits
+//    of the previous word) and a single right shift by 6 brings it back, thus replacing a per-lane variable shift and a mask.
+// Loop bounds are computed so that the last 16-byte load ends within the bytes covered by the n requested words.
+
+/// 8 words per iteration.
+__attribute__((target("ssse3")))
+inline size_t ssse3(const uint8_t* p, uint16_t* out, size_t n)
+{
+  const __m128i shuf = _mm_setr_epi8(1,0,2,1,3,2,4,3, 6,5,7,6,8,7,9,8);
+  const __m128i mul  = _mm_setr_epi16(1,4,16,64, 1,4,16,64);
+
+  size_t i = 0;
+  for (; i + 13 <= n; i += 8, p += 10) // 16-byte load -> 13 words must be requested
+  {
+    __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), shuf);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out+i), _mm_srli_epi16(_mm_mullo_epi16(v, mul), 6));
+  }
+  return i;
+}
+
+/// 16 words per iteration.
+__attribute__((target("avx2")))
+inline size_t avx2(const uint8_t* p, uint16_t* out, size_t n)
+{
+  const __m256i shuf = _mm256_setr_epi8(1,0,2,1,3,2,4,3, 6,5,7,6,8,7,9,8,
+                                        1,0,2,1,3,2,4,3, 6,5,7,6,8,7,9,8);
+  const __m256i mul  = _mm256_setr_epi16(1,4,16,64, 1,4,16,64, 1,4,16,64, 1,4,16,64);
+
+  size_t i = 0;
+  for (; i + 21 <= n; i += 16, p += 20) // last load ends at byte 26 -> 21 words must be requested
+  {
+    __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+                                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p+10)), 1);
+    v = _mm256_shuffle_epi8(v, shuf);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out+i), _mm256_srli_epi16(_mm256_mullo_epi16(v, mul), 6));
+  }
+  return i;
+}
+
+/// 32 words per iteration.
+__attribute__((target("avx512f,avx512bw")))
+inline size_t avx512(const uint8_t* p, uint16_t* out, size_t n)
+{
+  // same constants as above, repeated in each 128-bit lane
+  const __m512i shuf = _mm512_set4_epi64(0x0809070806070506, 0x0304020301020001, 0x0809070806070506, 0x0304020301020001);
+  const __m512i mul  = _mm512_set1_epi64(0x0040001000040001);
+
+  size_t i = 0;
+  for (; i + 37 <= n; i += 32, p += 40) // last load ends at byte 46 -> 37 words must be requested
+  {
+    __m512i v = _mm512_castsi128_si512(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p+10)), 1);
+    v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p+20)), 2);
+    v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p+30)), 3);
+    v = _mm512_shuffle_epi8(v, shuf);
+    _mm512_storeu_si512(out+i, _mm512_srli_epi16(_mm512_mullo_epi16(v, mul), 6));
+  }
+  return i;
+}
+#endif
+
+} // tb_unpack
+
 /// Parses 10-bits words from a source 8-bits buffer.
 struct tb_reader
 {
@@ -14,7 +106,7 @@ struct tb_reader
   ~tb_reader() = default;
 
   /// Fetches the nth 10-bit word from the buffer, starting from the leftmost bit
-  inline uint16_t operator[](size_t i)
+  inline uint16_t operator[](size_t i) const
   {
     // locate first bit to copy
     size_t buf_pos_bit  = buf_off + i * 10; // absolute pos of the first bit in the buffer
@@ -37,4 +129,57 @@ struct tb_reader
 
     return 0;
   }
+
+  /// @returns the count consecutive words starting at the word index first, as a range to be iterated sequentially
+  inline tb_range range(size_t first, size_t count) const
+  {
+    return tb_range{buf, buf_off + first * 10, first, count};
+  }
+
+  /// Decodes count consecutive words, starting at the word index first, into out.
+  /// The fastest kernel supported by the host is selected at runtime.
+  inline void unpack(uint16_t* out, size_t first, size_t count) const
+  {
+    unpack(out, first, count, simd_detect());
+  }
+
+  /// Decodes count consecutive words, starting at the word index first, into out, using at most the specified instruction set
+  /// (and at most the ones supported by the host). Words are decoded in bulk once the read position reaches a byte boundary.
+  /// Since each word moves the position by 2 bits, this never happens for odd bit offsets and such readers fall back to operator[].
+  inline void unpack(uint16_t* out, size_t first, size_t count, simd_level lvl) const
+  {
+    lvl = std::min(lvl, simd_detect());
+    size_t ii = 0;
+
+    // reach a byte boundary (at most 3 words)
+    for (; buf_off % 2 == 0 && ii < count && (buf_off + (first+ii) * 10) % 8 != 0; ++ii)
+    {
+      out[ii] = (*this)[first+ii];
+    }
+
+    if ((buf_off + (first+ii) * 10) % 8 == 0)
+    {
+      const uint8_t* p = buf + (buf_off + (first+ii) * 10) / 8;
+      size_t n = count - ii;
+      size_t done = 0;
+
+      switch (lvl)
+      {
+#ifdef BITREAD_X86
+      case simd_level::avx512: done += tb_unpack::avx512(p, out+ii, n);                                 [[fallthrough]];
+      case simd_level::avx2:   done += tb_unpack::avx2  (p + done/4*5, out+ii+done, n-done);            [[fallthrough]];
+      case simd_level::ssse3:  done += tb_unpack::ssse3 (p + done/4*5, out+ii+done, n-done);            [[fallthrough]];
+#endif
+      default:                 done += tb_unpack::scalar(p + done/4*5, out+ii+done, n-done);
+      }
+
+      ii += done;
+    }
+
+    // remaining words
+    for (; ii < count; ++ii)
+    {
+      out[ii] = (*this)[first+ii];
+    }
+  }
 };
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "simd.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+/// Bulk encoding kernels used by tb_writer::pack, mirroring tb_unpack.
+/// Every kernel expects a byte-aligned destination (the first word starts on the MSB of p[0]), encodes groups of 4 words (5 bytes)
+/// and returns the number of words it encoded. Only the 10 LSB of each source word are kept.
+/// Kernels never write past the last byte fully covered by the n requested words.
+namespace tb_pack
+{
+
+/// Encodes every complete group of 4 words, one group at a time.
+inline size_t scalar(const uint16_t* in, uint8_t* p, size_t n)
+{
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4, p += 5)
+  {
+    const uint64_t v = static_cast<uint64_t>(in[i]   & 0x3ff) << 30 |
+                       static_cast<uint64_t>(in[i+1] & 0x3ff) << 20 |
+                       static_cast<uint64_t>(in[i+2] & 0x3ff) << 10 |
+                       static_cast<uint64_t>(in[i+3] & 0x3ff);
+    p[0] = static_cast<uint8_t>(v >> 32);
+    p[1] = static_cast<uint8_t>(v >> 24);
+    p[2] = static_cast<uint8_t>(v >> 16);
+    p[3] = static_cast<uint8_t>(v >> 8);
+    p[4] = static_cast<uint8_t>(v);
+  }
+  return i;
+}
+
+#ifdef BITREAD_X86
+// The SIMD kernels share the same idea, applied on 8 words (10 destination bytes) per 128-bit lane:
+//  . a multiply-add merges each pair of words in a 32-bit lane (w0<<10 | w1).
+//  . a 64-bit shift merges each pair of 20-bit values in the 5 low bytes of a 64-bit lane (w0<<30 | w1<<20 | w2<<10 | w3),
+//    the bits pushed above byte 5 being ignored.
+//  . a byte shuffle writes both 5-byte groups in big-endian order at the beginning of the lane.
+// Each 16-byte store spills 6 bytes after the 10 it produces: they are overwritten by the next store (or the scalar tail),
+// loop bounds are computed so that the spill never goes past the bytes fully covered by the n requested words.
+
+/// 8 words per iteration.
+__attribute__((target("ssse3")))
+inline size_t ssse3(const uint16_t* in, uint8_t* p, size_t n)
+{
+  const __m128i mask = _mm_set1_epi16(0x3ff);
+  const __m128i madd = _mm_set1_epi32(0x00010400); // (1024, 1)
+  const __m128i shuf = _mm_setr_epi8(4,3,2,1,0, 12,11,10,9,8, -1,-1,-1,-1,-1,-1);
+
+  size_t i = 0;
+  for (; i + 13 <= n; i += 8, p += 10) // 16-byte store -> 13 words must be requested
+  {
+    __m128i v = _mm_madd_epi16(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in+i)), mask), madd);
+    v = _mm_or_si128(_mm_slli_epi64(v, 20), _mm_srli_epi64(v, 32));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_shuffle_epi8(v, shuf));
+  }
+  return i;
+}
+
+/// 16 words per iteration.
+__attribute__((target("avx2")))
+inline size_t avx2(const uint16_t* in, uint8_t* p, size_t n)
+{
+  const __m256i mask = _mm256_set1_epi16(0x3ff);
+  const __m256i madd = _mm256_set1_epi32(0x00010400);
+  const __m256i shuf = _mm256_setr_epi8(4,3,2,1,0, 12,11,10,9,8, -1,-1,-1,-1,-1,-1,
+                                        4,3,2,1,0, 12,11,10,9,8, -1,-1,-1,-1,-1,-1);
+
+  size_t i = 0;
+  for (; i + 21 <= n; i += 16, p += 20) // last store ends at byte 26 -> 21 words must be requested
+  {
+    __m256i v = _mm256_madd_epi16(_mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in+i)), mask), madd);
+    v = _mm256_shuffle_epi8(_mm256_or_si256(_mm256_slli_epi64(v, 20), _mm256_srli_epi64(v, 32)), shuf);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p),    _mm256_castsi256_si128(v));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p+10), _mm256_extracti128_si256(v, 1));
+  }
+  return i;
+}
+
+// GCC 12 AVX-512 headers trigger spurious -Wmaybe-uninitialized warnings (GCC PR 105593)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+/// 32 words per iteration.
+__attribute__((target("avx512f,avx512bw")))
+inline size_t avx512(const uint16_t* in, uint8_t* p, size_t n)
+{
+  const __m512i mask = _mm512_set1_epi16(0x3ff);
+  const __m512i madd = _mm512_set1_epi32(0x00010400);
+  // same shuffle as above, repeated in each 128-bit lane (-1 bytes zero the destination)
+  const __m512i shuf = _mm512_set4_epi64(static_cast<int64_t>(0xffffffffffff0809), 0x0a0b0c0001020304,
+                                         static_cast<int64_t>(0xffffffffffff0809), 0x0a0b0c0001020304);
+
+  size_t i = 0;
+  for (; i + 37 <= n; i += 32, p += 40) // last store ends at byte 46 -> 37 words must be requested
+  {
+    __m512i v = _mm512_madd_epi16(_mm512_and_si512(_mm512_loadu_si512(in+i), mask), madd);
+    v = _mm512_shuffle_epi8(_mm512_or_si512(_mm512_slli_epi64(v, 20), _mm512_srli_epi64(v, 32)), shuf);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p),    _mm512_extracti32x4_epi32(v, 0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p+10), _mm512_extracti32x4_epi32(v, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p+20), _mm512_extracti32x4_epi32(v, 2));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p+30), _mm512_extracti32x4_epi32(v, 3));
+  }
+  return i;
+}
+#pragma GCC diagnostic pop
+#endif
+
+} // tb_pack
+
+/// Writes 10-bits words into a destination 8-bits buffer, using the same layout as tb_reader.
+struct tb_writer
+{
+  uint8_t* buf;
+  size_t buf_off;
+
+  /// Use the provided 8-bits buffer as a destination and starts at the specified offset, in bits
+  inline tb_writer(uint8_t* buf, size_t offset=0): buf(buf), buf_off(offset) {}
+  tb_writer(const tb_writer&) = default;
+  tb_writer(tb_writer&&) = default;
+  ~tb_writer() = default;
+
+  /// Stores the 10 LSB of v as the nth 10-bit word of the buffer, leaving the surrounding bits untouched
+  inline void set(size_t i, uint16_t v) const
+  {
+    size_t buf_pos_bit  = buf_off + i * 10;
+    uint8_t* p = buf + buf_pos_bit / 8;
+    const unsigned sh = buf_pos_bit % 8;
+
+    // the word spans 2 or 3 bytes: work on a 24-bit big-endian window starting at the enclosing byte
+    const uint32_t m = static_cast<uint32_t>(0x3ff) << (14 - sh);
+    const uint32_t w = static_cast<uint32_t>(v & 0x3ff) << (14 - sh);
+
+    p[0] = static_cast<uint8_t>((p[0] & ~(m >> 16)) | (w >> 16));
+    p[1] = static_cast<uint8_t>((p[1] & ~(m >> 8))  | (w >> 8));
+    if (sh == 7)
+    {
+      p[2] = static_cast<uint8_t>((p[2] & ~m) | w);
+    }
+  }
+
+  /// Encodes count consecutive words from in, starting at the word index first.
+  /// The fastest kernel supported by the host is selected at runtime.
+  inline void pack(const uint16_t* in, size_t first, size_t count) const
+  {
+    pack(in, first, count, simd_detect());
+  }
+
+  /// Encodes count consecutive words from in, starting at the word index first, using at most the specified instruction set
+  /// (and at most the ones supported by the host). As for tb_reader::unpack, words are encoded in bulk once the write position
+  /// reaches a byte boundary (i.e: never for odd bit offsets).
+  inline void pack(const uint16_t* in, size_t first, size_t count, simd_level lvl) const
+  {
+    lvl = std::min(lvl, simd_detect());
+    size_t ii = 0;
+
+    // reach a byte boundary (at most 3 words)
+    for (; buf_off % 2 == 0 && ii < count && (buf_off + (first+ii) * 10) % 8 != 0; ++ii)
+    {
+      set(first+ii, in[ii]);
+    }
+
+    if ((buf_off + (first+ii) * 10) % 8 == 0)
+    {
+      uint8_t* p = buf + (buf_off + (first+ii) * 10) / 8;
+      size_t n = count - ii;
+      size_t done = 0;
+
+      switch (lvl)
+      {
+#ifdef BITREAD_X86
+      case simd_level::avx512: done += tb_pack::avx512(in+ii, p, n);                                 [[fallthrough]];
+      case simd_level::avx2:   done += tb_pack::avx2  (in+ii+done, p + done/4*5, n-done);            [[fallthrough]];
+      case simd_level::ssse3:  done += tb_pack::ssse3 (in+ii+done, p + done/4*5, n-done);            [[fallthrough]];
+#endif
+      default:                 done += tb_pack::scalar(in+ii+done, p + done/4*5, n-done);
+      }
+
+      ii += done;
+    }
+
+    // remaining words
+    for (; ii < count; ++ii)
+    {
+      set(first+ii, in[ii]);
+    }
+  }
+};
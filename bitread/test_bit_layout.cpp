@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+
+#include "bit_layout.h"
+
+#include <random>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+
+// MPEG-TS header
+struct sync_byte : field<8> {}; struct tei : field<1> {}; struct pusi : field<1> {}; struct prio : field<1> {}; struct pid : field<13> {};
+struct tsc : field<2> {};  struct afc : field<2> {}; struct cc : field<4> {};
+using ts_header = bit_layout<sync_byte, tei, pusi, prio, pid, tsc, afc, cc>;
+
+// field sizes at the boundaries: single bits, a whole byte, 64-bit fields and layouts, fields crossing 8-byte boundaries
+struct f1 : field<1> {}; struct f3 : field<3> {}; struct f7 : field<7> {}; struct f8 : field<8> {}; struct f9 : field<9> {};
+struct f13 : field<13> {}; struct f31 : field<31> {}; struct f33 : field<33> {}; struct f57 : field<57> {}; struct f64 : field<64> {};
+struct g1 : field<1> {}; struct g57 : field<57> {};
+
+using byte_layout   = bit_layout<f8>;
+using bits_layout   = bit_layout<f1, f3, g1>;           // 5 bits, the last byte being partially used
+using odd_layout    = bit_layout<f7, f9, f13, f3>;      // 32 bits, no field on a byte boundary but the last
+using full_layout   = bit_layout<f64>;                  // a single 64-bit field
+using edge_layout   = bit_layout<f7, f57>;              // 64 bits, the last field ending on the LSB of the load
+using split_layout  = bit_layout<f31, f33>;             // 64 bits, a field crossing the 32-bit boundary
+using large_layout  = bit_layout<f3, f57, f13, f1, g57, f31, g1>; // 163 bits: one load per field, crossing 64-bit words
+
+std::vector<uint8_t> random_bytes(size_t n, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> v(n);
+  for (auto& b : v) b = static_cast<uint8_t>(rng());
+  return v;
+}
+
+/// @returns the sz bits starting at bit off of p (MSB first), bit by bit
+uint64_t reference(const uint8_t* p, size_t off, size_t sz)
+{
+  uint64_t r = 0;
+  for (size_t ii=off; ii < off + sz; ++ii) r = (r << 1) | ((p[ii / 8] >> (7 - ii % 8)) & 1);
+  return r;
+}
+
+/// @returns the sz LSB of v
+uint64_t masked(uint64_t v, size_t sz)
+{
+  return sz == 64 ? v : v & ((static_cast<uint64_t>(1) << sz) - 1);
+}
+
+/// Compares decode() with the reference, and checks encode() -> decode() on random headers, over exactly sized buffers
+template<typename... F>
+void check(bit_layout<F...>)
+{
+  using L = bit_layout<F...>;
+  std::mt19937_64 rng(L::bits);
+  const auto field_eq = [](uint64_t a, uint64_t b, size_t off) { EXPECT_EQ(a, b) << L::bits << "-bit layout, field at " << off; };
+
+  for (unsigned ii=0; ii < 1000; ++ii)
+  {
+    const auto in = random_bytes(L::bytes, ii);
+    const auto v = L::decode(in.data());
+    (field_eq(v.template get<F>(), reference(in.data(), L::template offset<F>(), F::bits), L::template offset<F>()), ...);
+
+    typename L::values_t w;
+    ((w.template get<F>() = static_cast<typename F::value_type>(rng())), ...);
+    auto out = random_bytes(L::bytes, ii + 1);
+    const auto init = out;
+    L::encode(w, out.data());
+
+    const auto r = L::decode(out.data());
+    (field_eq(r.template get<F>(), masked(w.template get<F>(), F::bits), L::template offset<F>()), ...);
+    // bits following the layout are left untouched
+    EXPECT_EQ(reference(out.data(), L::bits, L::bytes * 8 - L::bits), reference(init.data(), L::bits, L::bytes * 8 - L::bits));
+    if (::testing::Test::HasFailure()) return;
+  }
+}
+
+/// Compares the batch decoding with the scalar one
+template<typename... F>
+void check_batch(bit_layout<F...>)
+{
+  using L = bit_layout<F...>;
+  const auto field_eq = [](uint64_t a, uint64_t b, size_t stride, size_t ii) { EXPECT_EQ(a, b) << "stride " << stride << ", header " << ii; };
+  for (const size_t stride : {L::bytes, L::bytes + 3, size_t(188)})
+  {
+    const size_t n = 257;
+    const auto in = random_bytes((n - 1) * stride + L::bytes, static_cast<unsigned>(stride));
+    std::tuple<std::vector<typename F::value_type>...> cols{std::vector<typename F::value_type>(n + 1, 0x5a)...};
+    L::decode(in.data(), stride, n, typename L::columns_t{std::make_tuple(std::get<L::template index<F>()>(cols).data()...)});
+
+    for (size_t ii=0; ii < n; ++ii)
+    {
+      const auto v = L::decode(in.data() + ii * stride);
+      (field_eq(std::get<L::template index<F>()>(cols)[ii], v.template get<F>(), stride, ii), ...);
+      if (::testing::Test::HasFailure()) return;
+    }
+    // nothing is written past n headers
+    (field_eq(std::get<L::template index<F>()>(cols)[n], static_cast<typename F::value_type>(0x5a), stride, n), ...);
+  }
+}
+
+} // namespace
+
+TEST(BitLayoutTest, ts_header)
+{
+  // PID 0x11, PUSI set, payload only, continuity counter 10
+  const uint8_t pkt[] = {0x47, 0x40, 0x11, 0x1a};
+  const auto h = ts_header::decode(pkt);
+  EXPECT_EQ(h.get<sync_byte>(), 0x47);
+  EXPECT_EQ(h.get<tei>(), 0);
+  EXPECT_EQ(h.get<pusi>(), 1);
+  EXPECT_EQ(h.get<prio>(), 0);
+  EXPECT_EQ(h.get<pid>(), 0x11);
+  EXPECT_EQ(h.get<tsc>(), 0);
+  EXPECT_EQ(h.get<afc>(), 1);
+  EXPECT_EQ(h.get<cc>(), 10);
+
+  uint8_t out[4] = {0, 0, 0, 0};
+  ts_header::encode(h, out);
+  for (size_t ii=0; ii < 4; ++ii) EXPECT_EQ(out[ii], pkt[ii]) << ii;
+
+  static_assert(ts_header::bits == 32 && ts_header::bytes == 4, "");
+  static_assert(ts_header::offset<pid>() == 11 && ts_header::index<cc>() == 7, "");
+  static_assert(std::is_same<pid::value_type, uint16_t>::value && std::is_same<f33::value_type, uint64_t>::value, "");
+}
+
+TEST(BitLayoutTest, boundaries)
+{
+  check(byte_layout{});
+  check(bits_layout{});
+  check(odd_layout{});
+  check(full_layout{});
+  check(edge_layout{});
+  check(split_layout{});
+}
+
+TEST(BitLayoutTest, large)
+{
+  static_assert(large_layout::bits == 163 && large_layout::bytes == 21, "");
+  check(large_layout{});
+}
+
+TEST(BitLayoutTest, bitread)
+{
+  // decode(bitread) matches decode(const uint8_t*), the layout starting on the MSB of the buffer
+  for (unsigned ii=0; ii < 100; ++ii)
+  {
+    const auto in = random_bytes(8, ii);
+    const bitread<uint64_t> b(in.data(), 8);
+
+    const auto v = odd_layout::decode(b);
+    const auto r = odd_layout::decode(in.data());
+    EXPECT_EQ(v.get<f7>(), r.get<f7>());
+    EXPECT_EQ(v.get<f9>(), r.get<f9>());
+    EXPECT_EQ(v.get<f13>(), r.get<f13>());
+    EXPECT_EQ(v.get<f3>(), r.get<f3>());
+
+    EXPECT_EQ(full_layout::decode(b).get<f64>(), full_layout::decode(in.data()).get<f64>());
+    EXPECT_EQ(split_layout::decode(b).get<f33>(), split_layout::decode(in.data()).get<f33>());
+  }
+}
+
+TEST(BitLayoutTest, batch)
+{
+  check_batch(ts_header{});
+  check_batch(bits_layout{});
+  check_batch(full_layout{});
+  check_batch(split_layout{});
+  check_batch(large_layout{});
+}
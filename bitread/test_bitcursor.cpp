@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+
+#include "bitcursor.h"
+
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+/// Reference MSB-first bit writer (bits of v above the 64th are written as 0)
+struct bit_sink
+{
+  std::vector<uint8_t> bytes;
+  size_t bits = 0;
+
+  void put(uint64_t v, unsigned n)
+  {
+    for (unsigned ii=n; ii-- > 0; ++bits)
+    {
+      if (bits % 8 == 0) bytes.push_back(0);
+      if (ii < 64 && ((v >> ii) & 1)) bytes.back() |= static_cast<uint8_t>(0x80 >> (bits % 8));
+    }
+  }
+
+  void ue(uint32_t k)
+  {
+    const uint64_t v = static_cast<uint64_t>(k) + 1;
+    unsigned lz = 0;
+    while ((v >> (lz + 1)) != 0) ++lz;
+    put(0, lz);
+    put(v, lz + 1);
+  }
+
+  void se(int32_t v)
+  {
+    ue(v > 0 ? static_cast<uint32_t>(2 * static_cast<int64_t>(v) - 1) : static_cast<uint32_t>(-2 * static_cast<int64_t>(v)));
+  }
+};
+
+/// @returns a random Exp-Golomb value, of 0 to 31 leading zeros
+uint32_t random_ue(std::mt19937_64& rng)
+{
+  const unsigned lz = rng() % 32;
+  return static_cast<uint32_t>((static_cast<uint64_t>(1) << lz) - 1 + (rng() & ((static_cast<uint64_t>(1) << lz) - 1)));
+}
+
+} // namespace
+
+TEST(BitcursorTest, read)
+{
+  // mixed fixed-size reads, flags & skips against the values written, over an exactly sized buffer
+  std::mt19937_64 rng(1);
+  bit_sink s;
+  std::vector<std::pair<unsigned, uint32_t>> fields;
+  for (size_t ii=0; ii < 2000; ++ii)
+  {
+    const unsigned n = rng() % 33;
+    const uint32_t v = static_cast<uint32_t>(rng() & ((static_cast<uint64_t>(1) << n) - 1));
+    fields.emplace_back(n, v);
+    s.put(v, n);
+  }
+
+  bitcursor c(s.bytes.data(), s.bytes.size());
+  size_t pos = 0;
+  for (size_t ii=0; ii < fields.size(); ++ii)
+  {
+    const auto [n, v] = fields[ii];
+    if (ii % 5 == 4)
+    {
+      c.skip(n);
+    }
+    else
+    {
+      ASSERT_EQ(c.peek(n), v) << "field " << ii;
+      ASSERT_EQ(c.read(n), v) << "field " << ii;
+    }
+    pos += n;
+    ASSERT_EQ(c.position(), pos);
+  }
+
+  EXPECT_EQ(c.bits_left(), s.bytes.size() * 8 - pos);
+  EXPECT_FALSE(c.overrun());
+  c.align();
+  EXPECT_TRUE(c.byte_aligned());
+  EXPECT_EQ(c.bits_left(), 0u);
+  EXPECT_FALSE(c.overrun());
+
+  // past the end: 0 bits, and overrun
+  EXPECT_EQ(c.read(32), 0u);
+  EXPECT_TRUE(c.overrun());
+  EXPECT_EQ(c.bits_left(), 0u);
+}
+
+TEST(BitcursorTest, offset)
+{
+  const uint8_t buf[] = {0x12, 0x34, 0x56};
+  bitcursor c(buf, sizeof(buf), 4);
+  EXPECT_EQ(c.position(), 4u);
+  EXPECT_FALSE(c.byte_aligned());
+  EXPECT_EQ(c.read(16), 0x2345u);
+  EXPECT_FALSE(c.read_flag());
+  c.align();
+  EXPECT_EQ(c.position(), 24u);
+  EXPECT_FALSE(c.overrun());
+}
+
+TEST(BitcursorTest, exp_golomb)
+{
+  // random ue(v) / se(v) / unary codes, interleaved with fixed-size fields, every code length being used
+  std::mt19937_64 rng(2);
+  bit_sink s;
+  std::vector<uint32_t> ue;
+  std::vector<int32_t> se;
+  std::vector<uint32_t> unary;
+  for (size_t ii=0; ii < 3000; ++ii)
+  {
+    ue.push_back(random_ue(rng));
+    s.ue(ue.back());
+    const uint32_t k = random_ue(rng) >> 1;
+    se.push_back(rng() % 2 ? static_cast<int32_t>(k) : -static_cast<int32_t>(k));
+    s.se(se.back());
+    unary.push_back(static_cast<uint32_t>(rng() % 100));
+    s.put(0, unary.back());
+    s.put(1, 1);
+    s.put(ii, 3);
+  }
+
+  bitcursor c(s.bytes.data(), s.bytes.size());
+  for (size_t ii=0; ii < ue.size(); ++ii)
+  {
+    ASSERT_EQ(c.read_ue(), ue[ii]) << ii;
+    ASSERT_EQ(c.read_se(), se[ii]) << ii;
+    ASSERT_EQ(c.read_unary(), unary[ii]) << ii;
+    ASSERT_EQ(c.read(3), ii % 8) << ii;
+  }
+  EXPECT_EQ(c.position(), s.bits);
+  EXPECT_FALSE(c.overrun());
+}
+
+TEST(BitcursorTest, exp_golomb_end)
+{
+  // codes ending on the last bit of the buffer, whatever their length and alignment: no overrun
+  std::mt19937_64 rng(3);
+  for (size_t ii=0; ii < 2000; ++ii)
+  {
+    const uint32_t v = random_ue(rng);
+    unsigned len = 1;
+    while ((static_cast<uint64_t>(v) + 1) >> ((len + 1) / 2)) len += 2;
+    const unsigned lead = static_cast<unsigned>(rng() % 8) * 8 + (8 - len % 8) % 8;
+
+    bit_sink s;
+    s.put(rng(), lead);
+    s.ue(v);
+    ASSERT_EQ(s.bits, lead + len);
+    ASSERT_EQ(s.bits % 8, 0u);
+
+    bitcursor c(s.bytes.data(), s.bytes.size(), lead);
+    ASSERT_EQ(c.read_ue(), v) << ii;
+    ASSERT_EQ(c.bits_left(), 0u) << ii;
+    ASSERT_FALSE(c.overrun()) << ii;
+
+    // the same code, truncated
+    if (s.bytes.size() > (lead + 7) / 8 + 1)
+    {
+      bitcursor t(s.bytes.data(), s.bytes.size() - 1, lead);
+      t.read_ue();
+      ASSERT_TRUE(t.overrun()) << ii;
+    }
+  }
+}
+
+TEST(BitcursorTest, malformed)
+{
+  // zeros up to the end of the buffer: at least 32 of them make a malformed code, fewer a truncated one
+  const std::vector<uint8_t> zeros(16, 0);
+  for (size_t n=0; n <= zeros.size(); ++n)
+  {
+    for (size_t off=0; off < 8; ++off)
+    {
+      bitcursor c(zeros.data(), n, off);
+      const uint32_t v = c.read_ue();
+      if (n * 8 >= off + 32)
+      {
+        ASSERT_EQ(v, std::numeric_limits<uint32_t>::max()) << "size " << n << ", offset " << off;
+      }
+      ASSERT_TRUE(c.overrun()) << "size " << n << ", offset " << off;
+      ASSERT_EQ(c.bits_left(), 0u);
+
+      bitcursor u(zeros.data(), n, off);
+      u.read_unary();
+      ASSERT_TRUE(u.overrun()) << "size " << n << ", offset " << off;
+    }
+  }
+
+  // 32 leading zeros are malformed, 31 are not
+  bit_sink s;
+  s.put(0, 32);
+  s.put(1, 1);
+  s.put(0, 63);
+  bitcursor c(s.bytes.data(), s.bytes.size());
+  EXPECT_EQ(c.read_ue(), std::numeric_limits<uint32_t>::max());
+  EXPECT_TRUE(c.overrun());
+
+  bitcursor d(s.bytes.data(), s.bytes.size(), 1);
+  EXPECT_EQ(d.read_ue(), 0x7fffffffu);
+  EXPECT_FALSE(d.overrun());
+}
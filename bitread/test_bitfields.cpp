@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include "bitfields.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+
+/// Bit by bit PEXT: the bits of v selected by mask, packed from the LSB
+uint64_t reference(uint64_t v, uint64_t mask)
+{
+  uint64_t r = 0;
+  unsigned n = 0;
+  for (unsigned ii=0; ii < 64; ++ii) if ((mask >> ii) & 1) r |= ((v >> ii) & 1) << n++;
+  return r;
+}
+
+template<typename F> constexpr uint64_t mask_of = bitfields_detail::field_mask<F>::value;
+
+/// Compares the single and batch (portable and PEXT) extractions with the reference, over random buffers
+template<typename buf_t, typename... Fields>
+void check(field_set<buf_t, Fields...>)
+{
+  using set = field_set<buf_t, Fields...>;
+  const size_t n = 1000;
+
+  std::mt19937_64 rng(sizeof...(Fields));
+  std::vector<bitread<buf_t>> in;
+  for (size_t ii=0; ii < n; ++ii) in.emplace_back(static_cast<buf_t>(rng()));
+
+  const auto field_eq = [](uint64_t a, uint64_t b, uint64_t mask, size_t ii, const char* path) { EXPECT_EQ(a, b) << path << ", mask " << std::hex << mask << std::dec << ", buffer " << ii; };
+
+  // get() clamps bmi2 to the host: on hosts without BMI2, both passes take the portable path
+  for (const bool bmi2 : {false, true})
+  {
+    // arrays rather than vectors: std::vector<bool> has no data()
+    std::tuple<std::unique_ptr<typename Fields::value_type[]>...> cols{std::make_unique<typename Fields::value_type[]>(n + 1)...};
+    std::apply([&](auto&... c) { (std::fill_n(c.get(), n + 1, static_cast<std::remove_reference_t<decltype(c[0])>>(0x5a)), ...); }, cols);
+    const auto out = std::apply([](auto&... c) { return typename set::columns_t{std::make_tuple(c.get()...)}; }, cols);
+    set::get(in.data(), n, out, bmi2);
+
+    std::apply([&](const auto&... c)
+    {
+      for (size_t ii=0; ii < n; ++ii)
+      {
+        const auto single = set::get(in[ii]);
+        const uint64_t w = in[ii].buf;
+        (field_eq(c[ii], reference(w, mask_of<Fields>), mask_of<Fields>, ii, bmi2 ? "PEXT" : "portable"), ...);
+        std::apply([&](const auto&... v) { (field_eq(v, reference(w, mask_of<Fields>), mask_of<Fields>, ii, "single"), ...); }, single);
+        if (::testing::Test::HasFailure()) return;
+      }
+      // nothing is written past n buffers
+      (field_eq(c[n], static_cast<typename Fields::value_type>(0x5a), mask_of<Fields>, n, bmi2 ? "PEXT" : "portable"), ...);
+    }, cols);
+  }
+}
+
+// MPEG PES timestamp, split in 3 parts by marker bits
+using pts = maskfield<uint64_t, 0x0e'fffe'fffe>;
+
+} // namespace
+
+TEST(BitfieldsTest, gather)
+{
+  static_assert(bitfields_detail::gather<0x0e'fffe'fffe>(0x0e'fffe'fffe) == (static_cast<uint64_t>(1) << 33) - 1, "");
+  static_assert(bitfields_detail::gather<0xf0>(0xab) == 0xa, "");
+  static_assert(bitfields_detail::gather<~static_cast<uint64_t>(0)>(0x0123456789abcdef) == 0x0123456789abcdef, "");
+  static_assert(bitfields_detail::gather<0x8000000000000001>(0x8000000000000000) == 2, "");
+  static_assert(bitfields_detail::contiguous(0x0ff0) && !bitfields_detail::contiguous(0x0f0f), "");
+
+  // PES timestamp: '0010', bits 32..30, marker, bits 29..15, marker, bits 14..0, marker
+  const uint64_t t = 0x1'2345'6789;
+  const uint16_t mid = static_cast<uint16_t>(((t >> 15) & 0x7fff) << 1 | 1), low = static_cast<uint16_t>((t & 0x7fff) << 1 | 1);
+  const uint8_t pes[] = {static_cast<uint8_t>(0x20 | (t >> 30) << 1 | 1), static_cast<uint8_t>(mid >> 8), static_cast<uint8_t>(mid),
+                         static_cast<uint8_t>(low >> 8), static_cast<uint8_t>(low)};
+  // bitread(const uint8_t*, size_t) loads the 5 bytes in the MSB: the mask expects them in the LSB
+  const auto [v] = field_set<uint64_t, pts>::get(bitread<uint64_t>(bitread<uint64_t>(pes, sizeof(pes)).buf >> 24));
+  EXPECT_EQ(v, t);
+}
+
+TEST(BitfieldsTest, contiguous)
+{
+  // contiguous fields only: both paths are the portable one
+  check(field_set<uint32_t, bitfield<bool, 22, 1>, bitfield<uint16_t, 8, 13>, bitfield<uint8_t, 0, 4>>{});
+  check(field_set<uint64_t, bitfield<uint64_t, 0, 64>, bitfield<uint8_t, 56, 8>>{});
+}
+
+TEST(BitfieldsTest, scattered)
+{
+  // scattered fields: PEXT vs portable, mixed with contiguous ones, overlapping, at either end of the buffer
+  check(field_set<uint64_t, pts, bitfield<uint8_t, 0, 1>, bitfield<uint8_t, 36, 4>>{});
+  check(field_set<uint64_t, maskfield<uint64_t, 0xaaaa'aaaa'aaaa'aaaa>, maskfield<uint32_t, 0x8000'0000'0000'0001>, maskfield<uint16_t, 0x00ff'0000'ff00'0000>>{});
+  check(field_set<uint16_t, maskfield<uint8_t, 0x8001>, maskfield<uint16_t, 0x5555>, bitfield<uint16_t, 0, 16>>{});
+  check(field_set<uint8_t, maskfield<uint8_t, 0x81>, maskfield<uint8_t, 0x3c>>{});
+}
@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+
+#include "bitscan.h"
+#include "packed_reader.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+
+std::vector<uint8_t> random_bytes(size_t n, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> v(n);
+  for (auto& b : v) b = static_cast<uint8_t>(rng());
+  return v;
+}
+
+/// @returns the bit pos of p (bit 0 being the MSB of the first byte)
+bool bit(const std::vector<uint8_t>& p, size_t pos)
+{
+  return (p[pos / 8] >> (7 - pos % 8)) & 1;
+}
+
+/// Bitmap of n bytes with only the bits at positions set
+std::vector<uint8_t> sparse(size_t n, const std::vector<size_t>& positions)
+{
+  std::vector<uint8_t> v(n, 0);
+  for (const size_t pos : positions) if (pos < n * 8) v[pos / 8] |= static_cast<uint8_t>(0x80 >> (pos % 8));
+  return v;
+}
+
+/// Extracts the bit plane k of count Bits-wide samples starting at first, with both kernels (the BMI2 one when supported),
+/// into exactly sized bitmaps, and compares them with packed_reader
+template<unsigned Bits>
+void check_plane()
+{
+  constexpr unsigned S = std::min(32u, 57u / Bits);
+  const auto src = random_bytes((300 * Bits + 7) / 8, Bits);
+
+  for (unsigned k=0; k < Bits; ++k)
+  {
+    for (size_t first : {0, 1, 7, 33})
+    {
+      for (size_t count=0; first + count <= 300; count += 1 + count / 8)
+      {
+        // the samples only: ASan catches reads past their last byte
+        const std::vector<uint8_t> in(src.begin(), src.begin() + static_cast<std::ptrdiff_t>(((first + count) * Bits + 7) / 8));
+        const packed_reader<Bits> ref(in.data(), in.size());
+
+        std::vector<uint8_t> expected((count + 7) / 8, 0);
+        for (size_t ii=0; ii < count; ++ii) if ((ref[first + ii] >> k) & 1) expected[ii / 8] |= static_cast<uint8_t>(0x80 >> (ii % 8));
+
+        std::vector<uint8_t> out((count + 7) / 8, 0xaa);
+        bitscan::detail::plane<Bits, S>(in.data(), first, count, out.data(), bitscan::detail::plane_gather<Bits, S>{k});
+        ASSERT_EQ(out, expected) << Bits << " bits, plane " << k << ", first " << first << ", count " << count;
+
+#ifdef BITREAD_X86
+        if (cpu_bits_detect().bmi2)
+        {
+          std::fill(out.begin(), out.end(), 0xaa);
+          bitscan::detail::plane_bmi2<Bits, S>(in.data(), first, count, k, out.data());
+          ASSERT_EQ(out, expected) << "BMI2, " << Bits << " bits, plane " << k << ", first " << first << ", count " << count;
+        }
+#endif
+
+        std::fill(out.begin(), out.end(), 0xaa);
+        bitscan::plane<Bits>(in.data(), first, count, k, out.data());
+        ASSERT_EQ(out, expected) << Bits << " bits, plane " << k << ", first " << first << ", count " << count;
+      }
+    }
+  }
+}
+
+} // namespace
+
+TEST(BitscanTest, popcount)
+{
+  // every kernel supported by the host, at every tail length
+  const auto src = random_bytes(300, 1);
+  for (size_t n=0; n < src.size(); ++n)
+  {
+    const std::vector<uint8_t> in(src.begin(), src.begin() + static_cast<std::ptrdiff_t>(n));
+    size_t expected = 0;
+    for (size_t ii=0; ii < n * 8; ++ii) expected += bit(in, ii);
+
+    ASSERT_EQ(bit_popcount::scalar(in.data(), n), expected) << n;
+#ifdef BITREAD_X86
+    if (cpu_bits_detect().popcnt)
+    {
+      ASSERT_EQ(bit_popcount::popcnt(in.data(), n), expected) << n;
+    }
+    if (cpu_bits_detect().popcnt && simd_detect() >= simd_level::avx2)
+    {
+      ASSERT_EQ(bit_popcount::avx2(in.data(), n), expected) << n;
+    }
+#endif
+  }
+}
+
+TEST(BitscanTest, count)
+{
+  const auto src = random_bytes(100, 2);
+  for (size_t first=0; first < 100; ++first)
+  {
+    size_t expected = 0;
+    for (size_t last=first; last <= 100 * 8; ++last)
+    {
+      // only the bytes holding bits of the range
+      const std::vector<uint8_t> in(src.begin(), src.begin() + static_cast<std::ptrdiff_t>((last + 7) / 8));
+      ASSERT_EQ(bitscan::count(in.data(), first, last), expected) << "[" << first << "; " << last << "[";
+      if (last < 100 * 8) expected += bit(src, last);
+    }
+  }
+  EXPECT_EQ(bitscan::count(src.data(), 10, 5), 0u);
+}
+
+TEST(BitscanTest, find_next)
+{
+  // sparse bitmaps: runs of all-zero 32-byte blocks, set bits at block boundaries and at either end of the range
+  const size_t n = 600;
+  const std::vector<std::vector<size_t>> patterns = {
+    {},
+    {0},
+    {n * 8 - 1},
+    {255, 256, 257},
+    {8 * 64 - 1, 8 * 96},
+    {8 * 33 + 3, 8 * 200 + 5, 8 * 201, 8 * 550 + 7},
+    {1000, 1001, 2048, 4095, 4096, 4799},
+  };
+
+  for (const auto& positions : patterns)
+  {
+    const auto src = sparse(n, positions);
+    for (size_t first=0; first < n * 8; first += 1 + first / 16)
+    {
+      for (size_t last : {first, first + 1, first + 7, first + 64, first + 255, first + 256, first + 1000, n * 8 - 1, n * 8})
+      {
+        if (last > n * 8) continue;
+        // only the bytes holding bits of the range: bits after last are set in the last byte
+        const std::vector<uint8_t> in(src.begin(), src.begin() + static_cast<std::ptrdiff_t>((last + 7) / 8));
+
+        size_t expected = first;
+        while (expected < last && !bit(in, expected)) ++expected;
+        ASSERT_EQ(bitscan::find_next(in.data(), first, last), expected) << "[" << first << "; " << last << "[";
+      }
+    }
+  }
+
+  // random density
+  const auto src = random_bytes(n, 3);
+  for (size_t first=0; first < n * 8; ++first)
+  {
+    size_t expected = first;
+    while (expected < n * 8 && !bit(src, expected)) ++expected;
+    ASSERT_EQ(bitscan::find_next(src.data(), first, n * 8), expected) << first;
+  }
+}
+
+TEST(BitscanTest, plane)
+{
+  check_plane<1>();
+  check_plane<3>();
+  check_plane<8>();
+  check_plane<10>();
+  check_plane<12>();
+  check_plane<17>();
+  check_plane<20>();
+  check_plane<32>();
+}
@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include "bitspan.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+
+std::vector<uint8_t> random_bytes(size_t n, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> v(n);
+  for (auto& b : v) b = static_cast<uint8_t>(rng());
+  return v;
+}
+
+/// @returns the sz bits starting at bit pos of p (MSB first), bit by bit, bits after the end of the buffer reading as 0
+uint64_t reference(const std::vector<uint8_t>& p, size_t pos, size_t sz)
+{
+  uint64_t r = 0;
+  for (size_t ii=pos; ii < pos + sz; ++ii) r = (r << 1) | (ii / 8 < p.size() ? (p[ii / 8] >> (7 - ii % 8)) & 1 : 0);
+  return r;
+}
+
+} // namespace
+
+TEST(BitspanTest, get)
+{
+  // TS header: PID 0x11, continuity counter 10
+  const uint8_t pkt[] = {0x47, 0x40, 0x11, 0x1a};
+  const bitspan s(pkt, sizeof(pkt));
+  EXPECT_EQ(s.bits(), 32u);
+  EXPECT_EQ(s.get<uint8_t>(0, 8), 0x47);
+  EXPECT_EQ(s.get<uint16_t>(11, 13), 0x11);
+  EXPECT_EQ((s.get<uint8_t, 28, 4>()), 10);
+  EXPECT_EQ(s.get<uint32_t>(0, 32), 0x4740111au);
+}
+
+TEST(BitspanTest, empty)
+{
+  // an empty field reads as 0, anywhere (including past the end of the buffer)
+  const uint8_t buf[] = {0xff, 0xff};
+  const bitspan s(buf, sizeof(buf));
+  for (size_t pos=0; pos < 24; ++pos) EXPECT_EQ(s.get<uint64_t>(pos, 0), 0u) << pos;
+}
+
+TEST(BitspanTest, fields)
+{
+  // every position & size, over exactly sized buffers (shorter and longer than the 64-bit window): ASan catches overreads
+  for (const size_t n : {1, 2, 7, 8, 9, 15, 16, 17, 24})
+  {
+    const auto buf = random_bytes(n, static_cast<unsigned>(n));
+    const bitspan s(buf.data(), buf.size());
+    for (size_t pos=0; pos < n * 8; ++pos)
+    {
+      for (size_t sz=0; sz <= 64; ++sz)
+      {
+        ASSERT_EQ(s.get<uint64_t>(pos, sz), reference(buf, pos, sz)) << "size " << n << ", position " << pos << ", field size " << sz;
+      }
+    }
+  }
+}
+
+TEST(BitspanTest, at)
+{
+  const auto buf = random_bytes(20, 1);
+  const bitspan s(buf.data(), buf.size());
+  for (size_t pos=0; pos < 160; ++pos)
+  {
+    const auto b = s.at<uint32_t>(pos);
+    ASSERT_EQ(b.buf, reference(buf, pos, 32)) << pos;
+    ASSERT_EQ(b.get<uint16_t>(3, 13), reference(buf, pos + 16, 13)) << pos;
+  }
+}
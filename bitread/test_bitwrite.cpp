@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include "bitread.h"
+#include "bitwrite.h"
+
+#include <random>
+
+TEST(BitwriteTest, set)
+{
+  bitwrite<uint16_t> b(0);
+  b.set(2, 4, 0b0011);
+  EXPECT_EQ(b.buf, 0b0000000000001100);
+
+  bitwrite<uint16_t> c(0b1111000000001111);
+  c.set(7, 7, 0b1100000);
+  EXPECT_EQ(c.buf, 0b1111000000001111);
+  c.set(4, 8, 0xfff); // bits above sz are ignored
+  EXPECT_EQ(c.buf, 0b1111111111111111);
+  c.set(0, 15, 0);    // the MSB is kept
+  EXPECT_EQ(c.buf, 0b1000000000000000);
+}
+
+TEST(BitwriteTest, store)
+{
+  const bitwrite<uint16_t> b(0b1111000000001111);
+  uint8_t buf[3] = {0, 0, 0xaa};
+  b.store(buf, 3); // at most sizeof(buf_t) bytes
+  EXPECT_EQ(buf[0], 0b11110000);
+  EXPECT_EQ(buf[1], 0b00001111);
+  EXPECT_EQ(buf[2], 0xaa);
+
+  const bitwrite<uint32_t> c(0x12345678);
+  c.store(buf, 2); // the MSB first
+  EXPECT_EQ(buf[0], 0x12);
+  EXPECT_EQ(buf[1], 0x34);
+}
+
+TEST(BitwriteTest, roundtrip)
+{
+  // set -> get, and store -> bitread(const uint8_t*, size_t), for random fields
+  std::mt19937_64 rng(1);
+  for (size_t ii=0; ii < 10000; ++ii)
+  {
+    const uint64_t init = rng();
+    const uint64_t sz = 1 + rng() % 63;
+    const uint64_t idx = rng() % (65 - sz);
+    const uint64_t v = rng();
+
+    bitwrite<uint64_t> w(init);
+    w.set(idx, sz, v);
+
+    const bitread<uint64_t> r(w.buf);
+    const uint64_t mask = ((static_cast<uint64_t>(1) << sz) - 1) << idx;
+    ASSERT_EQ(r.get<uint64_t>(idx, sz), v & (mask >> idx));
+    ASSERT_EQ(w.buf & ~mask, init & ~mask);
+
+    uint8_t buf[8];
+    w.store(buf, sizeof(buf));
+    ASSERT_EQ(bitread<uint64_t>(buf, sizeof(buf)).buf, w.buf);
+  }
+}
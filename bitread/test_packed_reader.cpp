@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include "packed_reader.h"
+#include "tb_reader.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+
+std::vector<uint8_t> random_bytes(size_t n, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> v(n);
+  for (auto& b : v) b = static_cast<uint8_t>(rng());
+  return v;
+}
+
+/// @returns the bits-wide word starting at bit pos of p, bit by bit
+template<bit_order Order>
+uint32_t reference(const std::vector<uint8_t>& p, size_t pos, unsigned bits)
+{
+  uint32_t r = 0;
+  for (unsigned ii=0; ii < bits; ++ii)
+  {
+    const size_t b = pos + ii;
+    if (Order == bit_order::msb_first) r = (r << 1) | ((p[b / 8] >> (7 - b % 8)) & 1);
+    else r |= static_cast<uint32_t>((p[b / 8] >> (b % 8)) & 1) << ii;
+  }
+  return r;
+}
+
+/// Reads every word of exactly sized buffers (so that ASan catches overreads past the tail), at every bit offset
+template<unsigned Bits, bit_order Order>
+void check()
+{
+  using reader = packed_reader<Bits, Order>;
+  for (size_t n=0; n < 24; ++n)
+  {
+    const auto buf = random_bytes(n, static_cast<unsigned>(n + Bits));
+    for (size_t off=0; off < 16; ++off)
+    {
+      const reader r(buf.data(), buf.size(), off);
+      const size_t words = n * 8 > off ? (n * 8 - off) / Bits : 0;
+      ASSERT_EQ(r.size(), words) << Bits << " bits, size " << n << ", offset " << off;
+
+      for (size_t ii=0; ii < words; ++ii)
+      {
+        ASSERT_EQ(r[ii], reference<Order>(buf, off + ii * Bits, Bits)) << Bits << " bits, size " << n << ", offset " << off << ", word " << ii;
+      }
+      for (size_t first=0; first < words; ++first)
+      {
+        std::vector<typename reader::value_type> out(words - first + 1, 0x5a);
+        r.unpack(out.data(), first, words - first);
+        for (size_t ii=first; ii < words; ++ii)
+        {
+          ASSERT_EQ(out[ii - first], r[ii]) << Bits << " bits, size " << n << ", offset " << off << ", first " << first << ", word " << ii;
+        }
+        ASSERT_EQ(out[words - first], 0x5a);
+      }
+    }
+  }
+}
+
+} // namespace
+
+TEST(PackedReaderTest, msb_first)
+{
+  check<1, bit_order::msb_first>();
+  check<3, bit_order::msb_first>();
+  check<8, bit_order::msb_first>();
+  check<10, bit_order::msb_first>();
+  check<12, bit_order::msb_first>();
+  check<17, bit_order::msb_first>();
+  check<31, bit_order::msb_first>();
+  check<32, bit_order::msb_first>();
+}
+
+TEST(PackedReaderTest, lsb_first)
+{
+  check<1, bit_order::lsb_first>();
+  check<3, bit_order::lsb_first>();
+  check<8, bit_order::lsb_first>();
+  check<10, bit_order::lsb_first>();
+  check<12, bit_order::lsb_first>();
+  check<17, bit_order::lsb_first>();
+  check<31, bit_order::lsb_first>();
+  check<32, bit_order::lsb_first>();
+}
+
+TEST(PackedReaderTest, tb_reader)
+{
+  // packed_reader<10> reads the layout of tb_reader
+  const auto buf = random_bytes(1000, 1);
+  for (size_t off=0; off < 8; ++off)
+  {
+    const packed_reader<10> r(buf.data(), buf.size(), off);
+    const tb_reader t(buf.data(), off);
+    for (size_t ii=0; ii < r.size(); ++ii) ASSERT_EQ(r[ii], t[ii]) << "offset " << off << ", word " << ii;
+  }
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include "tb_checked_reader.h"
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+const simd_level levels[] = {simd_level::scalar, simd_level::ssse3, simd_level::avx2, simd_level::avx512};
+
+std::vector<uint8_t> random_bytes(size_t n, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> v(n);
+  for (auto& b : v) b = static_cast<uint8_t>(rng());
+  return v;
+}
+
+} // namespace
+
+TEST(TbCheckedReaderTest, get)
+{
+  // every word of exactly sized buffers (ASan catches overreads), against a tb_reader over a padded copy
+  for (size_t n=0; n < 40; ++n)
+  {
+    const auto buf = random_bytes(n, static_cast<unsigned>(n));
+    auto padded = buf;
+    padded.resize(n + 8);
+    for (size_t off=0; off < 8; ++off)
+    {
+      const tb_checked_reader r(buf.data(), buf.size(), off);
+      const tb_reader ref(padded.data(), off);
+
+      ASSERT_EQ(r.size(), n * 8 > off ? (n * 8 - off) / 10 : 0) << "size " << n << ", offset " << off;
+      for (size_t ii=0; ii < r.size(); ++ii)
+      {
+        ASSERT_EQ(r[ii], ref[ii]) << "size " << n << ", offset " << off << ", word " << ii;
+        ASSERT_EQ(r.at(ii), ref[ii]) << "size " << n << ", offset " << off << ", word " << ii;
+      }
+      EXPECT_THROW(r.at(r.size()), std::out_of_range);
+      EXPECT_THROW(r.at(r.size() + 100), std::out_of_range);
+    }
+  }
+}
+
+TEST(TbCheckedReaderTest, unpack)
+{
+  // requests running past the end of the buffer are clamped: the words after the returned count are left untouched
+  const auto src = random_bytes(200, 1);
+  for (const auto lvl : levels)
+  {
+    for (size_t n : {0, 1, 2, 3, 5, 24, 25, 99, 100, 200})
+    {
+      const std::vector<uint8_t> buf(src.begin(), src.begin() + static_cast<std::ptrdiff_t>(n));
+      for (size_t off=0; off < 8; ++off)
+      {
+        const tb_checked_reader r(buf.data(), buf.size(), off);
+        const size_t size = r.size();
+        for (size_t first : {size_t(0), size_t(1), size / 2, size, size + 1, size + 1000})
+        {
+          for (size_t count : {size_t(0), size_t(1), size_t(7), size, size + 1, size_t(-1) / 2})
+          {
+            const size_t expected = first < size ? std::min(count, size - first) : 0;
+            std::vector<uint16_t> out(expected + 1, 0xffff);
+
+            ASSERT_EQ(r.unpack(out.data(), first, count, lvl), expected) << "level " << static_cast<int>(lvl) << ", size " << n << ", offset " << off << ", first " << first << ", count " << count;
+            for (size_t ii=0; ii < expected; ++ii) ASSERT_EQ(out[ii], r[first + ii]) << "level " << static_cast<int>(lvl) << ", size " << n << ", offset " << off << ", first " << first << ", word " << ii;
+            ASSERT_EQ(out[expected], 0xffff);
+
+            size_t ii = first;
+            for (const uint16_t w : r.range(first, count)) ASSERT_EQ(w, r[ii++]);
+            ASSERT_EQ(ii - first, expected) << "size " << n << ", offset " << off << ", first " << first << ", count " << count;
+          }
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include "tb_file.h"
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+
+const simd_level levels[] = {simd_level::scalar, simd_level::ssse3, simd_level::avx2, simd_level::avx512};
+
+std::vector<uint8_t> random_bytes(size_t n, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> v(n);
+  for (auto& b : v) b = static_cast<uint8_t>(rng());
+  return v;
+}
+
+/// Temporary file holding data, removed on destruction
+struct temp_file
+{
+  std::string path;
+
+  explicit temp_file(const std::vector<uint8_t>& data)
+  {
+    char tmpl[] = "/tmp/test_tb_file.XXXXXX";
+    const int fd = ::mkstemp(tmpl);
+    if (fd < 0) throw std::runtime_error{std::string("Failed to create a temporary file: ") + strerror(errno)};
+    path = tmpl;
+    const bool ok = data.empty() || ::write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size());
+    ::close(fd);
+    if (!ok) throw std::runtime_error{"Failed to write " + path};
+  }
+
+  ~temp_file() { ::unlink(path.c_str()); }
+};
+
+} // namespace
+
+TEST(TbFileTest, frames)
+{
+  // a header, 5 frames that are not page-aligned, and a partial frame
+  const size_t header = 100, frame_sz = 12345, words = frame_sz * 8 / 10;
+  const auto data = random_bytes(header + 5 * frame_sz + 1000, 1);
+  const temp_file tmp(data);
+
+  const tb_file f(tmp.path, frame_sz, header);
+  EXPECT_EQ(f.size(), data.size());
+  EXPECT_EQ(f.frame_size(), frame_sz);
+  ASSERT_EQ(f.frames(), 5u);
+
+  for (size_t i=0; i < f.frames(); ++i)
+  {
+    // the mapped frame reads like an in-memory one, at every level
+    const tb_reader ref(data.data() + header + i * frame_sz);
+    ASSERT_EQ(f.frame_data(i), f.data() + header + i * frame_sz);
+    for (const auto lvl : levels)
+    {
+      std::vector<uint16_t> out(words), expected(words);
+      f.frame(i).unpack(out.data(), 0, words, lvl);
+      ref.unpack(expected.data(), 0, words, simd_level::scalar);
+      ASSERT_EQ(out, expected) << "frame " << i << ", level " << static_cast<int>(lvl);
+    }
+
+    // dropped pages are read back from the page cache
+    f.release(i);
+    ASSERT_EQ(f.frame(i)[words - 1], ref[words - 1]);
+  }
+
+  // hints on frames past the end are ignored
+  f.prefetch(5);
+  f.release(100);
+}
+
+TEST(TbFileTest, sizes)
+{
+  const temp_file empty({});
+  EXPECT_EQ(tb_file(empty.path, 10).frames(), 0u);
+
+  const temp_file small(random_bytes(50, 2));
+  EXPECT_EQ(tb_file(small.path, 10).frames(), 5u);
+  EXPECT_EQ(tb_file(small.path, 10, 5).frames(), 4u);
+  EXPECT_EQ(tb_file(small.path, 10, 50).frames(), 0u);
+  EXPECT_EQ(tb_file(small.path, 10, 60).frames(), 0u);
+  EXPECT_EQ(tb_file(small.path, 51).frames(), 0u);
+}
+
+TEST(TbFileTest, errors)
+{
+  const temp_file tmp(random_bytes(50, 3));
+  EXPECT_THROW(tb_file(tmp.path, 0), std::runtime_error);
+  EXPECT_THROW(tb_file(tmp.path + ".missing", 10), std::runtime_error);
+}
+
+TEST(TbFileTest, move)
+{
+  const auto data = random_bytes(100, 4);
+  const temp_file tmp(data);
+
+  tb_file a(tmp.path, 10);
+  tb_file b(std::move(a));
+  EXPECT_EQ(a.data(), nullptr);
+  EXPECT_EQ(a.frames(), 0u);
+  ASSERT_EQ(b.frames(), 10u);
+  EXPECT_EQ(b.frame_data(9)[9], data[99]);
+
+  tb_file c(tmp.path, 20);
+  c = std::move(b);
+  EXPECT_EQ(c.frames(), 10u);
+  EXPECT_EQ(c.frame_data(3)[0], data[30]);
+}
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include "tb_reader.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+
+const simd_level levels[] = {simd_level::scalar, simd_level::ssse3, simd_level::avx2, simd_level::avx512};
+
+std::vector<uint8_t> random_bytes(size_t n, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> v(n);
+  for (auto& b : v) b = static_cast<uint8_t>(rng());
+  return v;
+}
+
+/// @returns the number of bytes holding the words [0; count[ of a reader starting at the bit offset off
+size_t bytes_of(size_t off, size_t count)
+{
+  return (off + count * 10 + 7) / 8;
+}
+
+} // namespace
+
+TEST(TbReaderTest, get)
+{
+  // 4 words: 0x3ff 0x000 0x155 0x2aa
+  const uint8_t buf[] = {0xff, 0xc0, 0x05, 0x56, 0xaa};
+  const tb_reader r(buf);
+  EXPECT_EQ(r[0], 0x3ff);
+  EXPECT_EQ(r[1], 0x000);
+  EXPECT_EQ(r[2], 0x155);
+  EXPECT_EQ(r[3], 0x2aa);
+
+  // same words, starting 1 bit later
+  const uint8_t shifted[] = {0x7f, 0xe0, 0x02, 0xab, 0x55, 0x00};
+  const tb_reader s(shifted, 1);
+  for (size_t ii=0; ii < 4; ++ii) EXPECT_EQ(s[ii], r[ii]);
+}
+
+TEST(TbReaderTest, kernels)
+{
+  // every kernel supported by the host, at every tail length: exactly sized buffers let ASan catch overreads
+  const auto src = random_bytes(bytes_of(0, 200), 1);
+  const tb_reader ref(src.data());
+
+  for (const auto lvl : levels)
+  {
+    if (lvl > simd_detect()) continue;
+    for (size_t n=0; n < 200; ++n)
+    {
+      const std::vector<uint8_t> in(src.begin(), src.begin() + static_cast<std::ptrdiff_t>(bytes_of(0, n)));
+      std::vector<uint16_t> out(n + 1, 0xffff);
+
+      size_t done = 0;
+      switch (lvl)
+      {
+#ifdef BITREAD_X86
+      case simd_level::avx512: done = tb_unpack::avx512(in.data(), out.data(), n); break;
+      case simd_level::avx2:   done = tb_unpack::avx2  (in.data(), out.data(), n); break;
+      case simd_level::ssse3:  done = tb_unpack::ssse3 (in.data(), out.data(), n); break;
+#endif
+      default:                 done = tb_unpack::scalar(in.data(), out.data(), n);
+      }
+
+      ASSERT_LE(done, n);
+      ASSERT_EQ(done % 4, 0u);
+      if (lvl == simd_level::scalar)
+      {
+        ASSERT_EQ(done, n / 4 * 4);
+      }
+      for (size_t ii=0; ii < done; ++ii) ASSERT_EQ(out[ii], ref[ii]) << "level " << static_cast<int>(lvl) << ", n " << n << ", word " << ii;
+      for (size_t ii=done; ii <= n; ++ii) ASSERT_EQ(out[ii], 0xffff) << "level " << static_cast<int>(lvl) << ", n " << n << ", word " << ii;
+    }
+  }
+}
+
+TEST(TbReaderTest, unpack)
+{
+  // every level (levels above the host's are clamped), bit offset, first word and tail length
+  const auto src = random_bytes(256, 2);
+
+  for (const auto lvl : levels)
+  {
+    for (size_t off=0; off < 8; ++off)
+    {
+      for (size_t first=0; first < 8; ++first)
+      {
+        for (size_t count=0; count < 150; ++count)
+        {
+          const std::vector<uint8_t> in(src.begin(), src.begin() + static_cast<std::ptrdiff_t>(bytes_of(off, first + count)));
+          const tb_reader r(in.data(), off);
+          std::vector<uint16_t> out(count + 1, 0xffff);
+          r.unpack(out.data(), first, count, lvl);
+
+          for (size_t ii=0; ii < count; ++ii)
+          {
+            ASSERT_EQ(out[ii], r[first+ii]) << "level " << static_cast<int>(lvl) << ", offset " << off << ", first " << first << ", count " << count << ", word " << ii;
+          }
+          ASSERT_EQ(out[count], 0xffff);
+        }
+      }
+    }
+  }
+}
+
+TEST(TbReaderTest, range)
+{
+  const auto src = random_bytes(bytes_of(6, 100), 3);
+  const tb_reader r(src.data(), 6);
+
+  size_t ii = 3;
+  for (uint16_t w : r.range(3, 90)) ASSERT_EQ(w, r[ii++]);
+  EXPECT_EQ(ii, 93u);
+  EXPECT_TRUE(r.range(5, 0).empty());
+}
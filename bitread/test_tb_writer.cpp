@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include "tb_reader.h"
+#include "tb_writer.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+
+const simd_level levels[] = {simd_level::scalar, simd_level::ssse3, simd_level::avx2, simd_level::avx512};
+
+/// Random words, the 6 MSB being set as well: they must be ignored
+std::vector<uint16_t> random_words(size_t n, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::vector<uint16_t> v(n);
+  for (auto& w : v) w = static_cast<uint16_t>(rng());
+  return v;
+}
+
+std::vector<uint8_t> random_bytes(size_t n, unsigned seed)
+{
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> v(n);
+  for (auto& b : v) b = static_cast<uint8_t>(rng());
+  return v;
+}
+
+/// @returns the number of bytes holding the words [0; count[ of a writer starting at the bit offset off
+size_t bytes_of(size_t off, size_t count)
+{
+  return (off + count * 10 + 7) / 8;
+}
+
+} // namespace
+
+TEST(TbWriterTest, set)
+{
+  // the words of TbReaderTest.get, over a buffer of ones: bits outside of the words are kept
+  uint8_t buf[6] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+  const tb_writer w(buf, 1);
+  w.set(0, 0x3ff);
+  w.set(1, 0x000);
+  w.set(2, 0x155);
+  w.set(3, 0xfeaa); // only the 10 LSB are kept
+
+  const uint8_t expected[] = {0xff, 0xe0, 0x02, 0xab, 0x55, 0x7f};
+  for (size_t ii=0; ii < sizeof(buf); ++ii) EXPECT_EQ(buf[ii], expected[ii]) << ii;
+}
+
+TEST(TbWriterTest, kernels)
+{
+  // every kernel supported by the host, at every tail length: bytes that are not fully covered by the n words are left untouched
+  // (the bytes of the words following the encoded ones may be overwritten: tb_writer::pack rewrites them)
+  const auto in = random_words(200, 1);
+
+  for (const auto lvl : levels)
+  {
+    if (lvl > simd_detect()) continue;
+    for (size_t n=0; n < 200; ++n)
+    {
+      const auto init = random_bytes(bytes_of(0, n), 2);
+      auto out = init;
+
+      size_t done = 0;
+      switch (lvl)
+      {
+#ifdef BITREAD_X86
+      case simd_level::avx512: done = tb_pack::avx512(in.data(), out.data(), n); break;
+      case simd_level::avx2:   done = tb_pack::avx2  (in.data(), out.data(), n); break;
+      case simd_level::ssse3:  done = tb_pack::ssse3 (in.data(), out.data(), n); break;
+#endif
+      default:                 done = tb_pack::scalar(in.data(), out.data(), n);
+      }
+
+      ASSERT_LE(done, n);
+      ASSERT_EQ(done % 4, 0u);
+      const tb_reader r(out.data());
+      for (size_t ii=0; ii < done; ++ii) ASSERT_EQ(r[ii], in[ii] & 0x3ff) << "level " << static_cast<int>(lvl) << ", n " << n << ", word " << ii;
+      for (size_t ii=n * 10 / 8; ii < out.size(); ++ii) ASSERT_EQ(out[ii], init[ii]) << "level " << static_cast<int>(lvl) << ", n " << n << ", byte " << ii;
+    }
+  }
+}
+
+TEST(TbWriterTest, pack)
+{
+  // every level (levels above the host's are clamped), bit offset, first word and tail length, against set()
+  const auto in = random_words(150, 3);
+
+  for (const auto lvl : levels)
+  {
+    for (size_t off=0; off < 8; ++off)
+    {
+      for (size_t first=0; first < 8; ++first)
+      {
+        for (size_t count=0; count < 150; ++count)
+        {
+          const auto init = random_bytes(bytes_of(off, first + count) + 1, static_cast<unsigned>(count));
+          auto out = init;
+          auto expected = init;
+
+          tb_writer(out.data(), off).pack(in.data(), first, count, lvl);
+          const tb_writer ref(expected.data(), off);
+          for (size_t ii=0; ii < count; ++ii) ref.set(first + ii, in[ii]);
+
+          ASSERT_EQ(out, expected) << "level " << static_cast<int>(lvl) << ", offset " << off << ", first " << first << ", count " << count;
+        }
+      }
+    }
+  }
+}
+
+TEST(TbWriterTest, roundtrip)
+{
+  // pack -> unpack at every level, with a bit offset that reaches a byte boundary after 2 words
+  const auto in = random_words(3840 * 2, 4);
+
+  for (const auto lvl : levels)
+  {
+    std::vector<uint8_t> buf(bytes_of(4, in.size()));
+    tb_writer(buf.data(), 4).pack(in.data(), 0, in.size(), lvl);
+
+    std::vector<uint16_t> out(in.size());
+    tb_reader(buf.data(), 4).unpack(out.data(), 0, out.size(), lvl);
+    for (size_t ii=0; ii < in.size(); ++ii) ASSERT_EQ(out[ii], in[ii] & 0x3ff) << "level " << static_cast<int>(lvl) << ", word " << ii;
+  }
+}
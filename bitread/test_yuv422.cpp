@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+
+#include "yuv422.h"
+
+#include <random>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+
+constexpr size_t HEIGHT = 5;
+constexpr size_t PADDING = 64; // bytes after each line, which must be left untouched
+constexpr uint8_t GUARD = 0xee;
+
+/// A frame of HEIGHT lines in the layout L, with reference (sample per sample) accessors
+template<typename L>
+struct test_frame
+{
+  static constexpr bool is_planar = std::is_same<L, yuv422::planar>::value;
+
+  size_t width;
+  std::vector<uint8_t> planes[3];
+  size_t line_size[3] = {0, 0, 0};
+  size_t stride[3] = {0, 0, 0};
+
+  explicit test_frame(size_t w)
+    : width(w)
+  {
+    line_size[0] = L::line_size(w);
+    if (is_planar) line_size[1] = line_size[2] = w;
+    for (size_t k=0; k < 3; ++k)
+    {
+      if (!line_size[k]) continue;
+      stride[k] = line_size[k] + PADDING;
+      planes[k].assign(stride[k] * HEIGHT, 0);
+      for (size_t l=0; l < HEIGHT; ++l) std::fill_n(planes[k].begin() + static_cast<std::ptrdiff_t>(l * stride[k] + line_size[k]), PADDING, GUARD);
+    }
+  }
+
+  yuv422::frame_t<uint8_t> frame()
+  {
+    return {{data(0), data(1), data(2)}, {stride[0], stride[1], stride[2]}};
+  }
+
+  yuv422::frame_t<const uint8_t> cframe()
+  {
+    return {{data(0), data(1), data(2)}, {stride[0], stride[1], stride[2]}};
+  }
+
+  /// @returns the ith sample (Cb Y Cr Y order) of the line l
+  uint16_t get(size_t l, size_t i) const
+  {
+    const uint8_t* p = planes[0].data() + l * stride[0];
+    if constexpr (std::is_same<L, yuv422::packed10>::value) return tb_reader(p)[i];
+    else if constexpr (std::is_same<L, yuv422::v210>::value) return static_cast<uint16_t>((load_le32(p + i / 3 * 4) >> (i % 3 * 10)) & 0x3ff);
+    else if constexpr (std::is_same<L, yuv422::uyvy16>::value) return reinterpret_cast<const uint16_t*>(p)[i];
+    else return plane_sample(l, i);
+  }
+
+  /// Sets the ith sample (Cb Y Cr Y order) of the line l
+  void set(size_t l, size_t i, uint16_t v)
+  {
+    uint8_t* p = planes[0].data() + l * stride[0];
+    if constexpr (std::is_same<L, yuv422::packed10>::value) tb_writer(p).set(i, v);
+    else if constexpr (std::is_same<L, yuv422::v210>::value) store_le32(p + i / 3 * 4, (load_le32(p + i / 3 * 4) & ~(0x3ffu << (i % 3 * 10))) | static_cast<uint32_t>(v) << (i % 3 * 10));
+    else if constexpr (std::is_same<L, yuv422::uyvy16>::value) reinterpret_cast<uint16_t*>(p)[i] = v;
+    else plane_sample(l, i) = v;
+  }
+
+  /// Fills every sample with random 10-bit values
+  void randomize(unsigned seed)
+  {
+    std::mt19937 rng(seed);
+    for (size_t l=0; l < HEIGHT; ++l)
+    {
+      for (size_t i=0; i < width * 2; ++i) set(l, i, static_cast<uint16_t>(rng() & 0x3ff));
+    }
+  }
+
+  /// @returns true if the padding after every line was left untouched
+  bool guards_intact() const
+  {
+    for (size_t k=0; k < 3; ++k)
+    {
+      for (size_t l=0; l < (line_size[k] ? HEIGHT : 0); ++l)
+      {
+        for (size_t ii=0; ii < PADDING; ++ii) if (planes[k][l * stride[k] + line_size[k] + ii] != GUARD) return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  uint8_t* data(size_t k) { return planes[k].empty() ? nullptr : planes[k].data(); }
+
+  uint16_t& plane_sample(size_t l, size_t i)
+  {
+    uint16_t* y  = reinterpret_cast<uint16_t*>(planes[0].data() + l * stride[0]);
+    uint16_t* cb = reinterpret_cast<uint16_t*>(planes[1].data() + l * stride[1]);
+    uint16_t* cr = reinterpret_cast<uint16_t*>(planes[2].data() + l * stride[2]);
+    switch (i % 4)
+    {
+    case 0:  return cb[i / 4];
+    case 2:  return cr[i / 4];
+    default: return y[i / 2];
+    }
+  }
+
+  uint16_t plane_sample(size_t l, size_t i) const
+  {
+    return const_cast<test_frame*>(this)->plane_sample(l, i);
+  }
+};
+
+/// Converts a random Src frame to Dst and compares every sample
+template<typename Src, typename Dst>
+void check(const std::vector<size_t>& widths)
+{
+  for (const size_t w : widths)
+  {
+    test_frame<Src> src(w);
+    src.randomize(static_cast<unsigned>(w));
+    test_frame<Dst> dst(w);
+
+    yuv422::convert_frame<Src, Dst>(src.cframe(), dst.frame(), w, HEIGHT);
+
+    for (size_t l=0; l < HEIGHT; ++l)
+    {
+      for (size_t i=0; i < w * 2; ++i) ASSERT_EQ(dst.get(l, i), src.get(l, i)) << "width " << w << ", line " << l << ", sample " << i;
+    }
+    ASSERT_TRUE(dst.guards_intact()) << "width " << w;
+  }
+}
+
+// widths that are not multiples of the v210 groups (6 pixels), of the SIMD steps (8 & 16 pixels) nor of yuv422::block_px
+const std::vector<size_t> even_widths = {2, 4, 6, 8, 10, 14, 16, 18, 46, 48, 50, 190, 192, 194, 384, 386, 1920, 1922};
+// odd widths, supported by the interleaved layouts
+const std::vector<size_t> odd_widths = {1, 3, 5, 7, 9, 15, 17, 47, 49, 191, 193, 385, 1921};
+
+} // namespace
+
+TEST(Yuv422Test, packed10)
+{
+  check<yuv422::packed10, yuv422::v210>(even_widths);
+  check<yuv422::packed10, yuv422::uyvy16>(even_widths);
+  check<yuv422::packed10, yuv422::planar>(even_widths);
+  check<yuv422::packed10, yuv422::v210>(odd_widths);
+  check<yuv422::packed10, yuv422::uyvy16>(odd_widths);
+}
+
+TEST(Yuv422Test, v210)
+{
+  check<yuv422::v210, yuv422::packed10>(even_widths);
+  check<yuv422::v210, yuv422::uyvy16>(even_widths);
+  check<yuv422::v210, yuv422::planar>(even_widths);
+  check<yuv422::v210, yuv422::packed10>(odd_widths);
+  check<yuv422::v210, yuv422::uyvy16>(odd_widths);
+}
+
+TEST(Yuv422Test, uyvy16)
+{
+  check<yuv422::uyvy16, yuv422::packed10>(even_widths);
+  check<yuv422::uyvy16, yuv422::v210>(even_widths);
+  check<yuv422::uyvy16, yuv422::planar>(even_widths);
+  check<yuv422::uyvy16, yuv422::packed10>(odd_widths);
+  check<yuv422::uyvy16, yuv422::v210>(odd_widths);
+}
+
+TEST(Yuv422Test, planar)
+{
+  check<yuv422::planar, yuv422::packed10>(even_widths);
+  check<yuv422::planar, yuv422::v210>(even_widths);
+  check<yuv422::planar, yuv422::uyvy16>(even_widths);
+}
+
+TEST(Yuv422Test, v210_padding)
+{
+  // the end of the last group is padded with 0
+  for (const size_t w : {2, 4, 8, 46})
+  {
+    test_frame<yuv422::uyvy16> src(w);
+    src.randomize(1);
+    test_frame<yuv422::v210> dst(w);
+    std::fill(dst.planes[0].begin(), dst.planes[0].end(), 0xff);
+
+    yuv422::convert_frame<yuv422::uyvy16, yuv422::v210>(src.cframe(), dst.frame(), w, HEIGHT);
+    for (size_t i=w * 2; i < (w + 5) / 6 * 12; ++i) ASSERT_EQ(dst.get(0, i), 0) << "width " << w << ", sample " << i;
+  }
+}
+
+TEST(Yuv422Test, roundtrip)
+{
+  // packed10 -> v210 -> planar -> uyvy16 -> packed10
+  for (const size_t w : even_widths)
+  {
+    test_frame<yuv422::packed10> src(w);
+    src.randomize(static_cast<unsigned>(w));
+    test_frame<yuv422::v210> v210(w);
+    test_frame<yuv422::planar> planar(w);
+    test_frame<yuv422::uyvy16> uyvy16(w);
+    test_frame<yuv422::packed10> dst(w);
+
+    yuv422::convert_frame<yuv422::packed10, yuv422::v210>(src.cframe(), v210.frame(), w, HEIGHT);
+    yuv422::convert_frame<yuv422::v210, yuv422::planar>(v210.cframe(), planar.frame(), w, HEIGHT);
+    yuv422::convert_frame<yuv422::planar, yuv422::uyvy16>(planar.cframe(), uyvy16.frame(), w, HEIGHT);
+    yuv422::convert_frame<yuv422::uyvy16, yuv422::packed10>(uyvy16.cframe(), dst.frame(), w, HEIGHT);
+
+    ASSERT_EQ(dst.planes[0], src.planes[0]) << "width " << w;
+  }
+}
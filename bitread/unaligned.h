@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// Unaligned loads & stores used by the stream readers and converters of this folder.
+// The *_tail variants only touch the n (< 8) first bytes and are meant for the end of buffers.
+
+/// @returns the 8 bytes at p as a big-endian value (p[0] ends up in the MSB)
+inline uint64_t load_be64(const uint8_t* p)
+{
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+/// @returns the 8 bytes at p as a little-endian value (p[0] ends up in the LSB)
+inline uint64_t load_le64(const uint8_t* p)
+{
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+/// Same as load_be64, missing bytes are read as 0.
+inline uint64_t load_be64_tail(const uint8_t* p, size_t n)
+{
+  uint64_t v = 0;
+  for (size_t ii=0; ii < n && ii < 8; ++ii) v |= static_cast<uint64_t>(p[ii]) << ((7-ii) * 8);
+  return v;
+}
+
+/// Same as load_le64, missing bytes are read as 0.
+inline uint64_t load_le64_tail(const uint8_t* p, size_t n)
+{
+  uint64_t v = 0;
+  for (size_t ii=0; ii < n && ii < 8; ++ii) v |= static_cast<uint64_t>(p[ii]) << (ii * 8);
+  return v;
+}
+
+/// @returns the 4 bytes at p as a little-endian value
+inline uint32_t load_le32(const uint8_t* p)
+{
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap32(v);
+#endif
+  return v;
+}
+
+/// Stores v at p, LSB first
+inline void store_le32(uint8_t* p, uint32_t v)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap32(v);
+#endif
+  std::memcpy(p, &v, sizeof(v));
+}
+
+/// @returns the N (1 to 8) bytes at p as the MSB of a big-endian value, the remaining bytes being 0
+template<size_t N> inline uint64_t load_be(const uint8_t* p)
+{
+  static_assert(N >= 1 && N <= 8, "1 to 8 bytes");
+  uint64_t v = 0;
+  std::memcpy(&v, p, N);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+/// Stores the N (1 to 8) MSB of v at p
+template<size_t N> inline void store_be(uint8_t* p, uint64_t v)
+{
+  static_assert(N >= 1 && N <= 8, "1 to 8 bytes");
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  std::memcpy(p, &v, N);
+}
@@ -0,0 +1,299 @@
+#pragma once
+
+#include "unaligned.h"
+#include "tb_reader.h"
+#include "tb_writer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * Conversions between the 10-bit 4:2:2 video layouts found on SDI capture paths:
+ *  . packed10: big-endian packed 10-bit words (tb_reader layout), Cb Y Cr Y order.
+ *  . v210: 3 samples per little-endian 32-bit word (bits 0-9, 10-19, 20-29), Cb Y Cr Y order, lines padded to 48 pixels (128 bytes).
+ *  . uyvy16: one sample per native 16-bit word (10 LSB), Cb Y Cr Y order.
+ *  . planar: one 16-bit plane per component (10 LSB), chroma planes holding width/2 samples.
+ *
+ * A line is converted in a single pass: blocks of block_px pixels are decoded into interleaved Cb Y Cr Y samples held in a small
+ * stack buffer (which stays in L1) and immediately encoded to the destination layout.
+ * Widths must be even when converting from or to planar (interleaved layouts accept any width).
+ * No layout accesses more than line_size(width) bytes per line (per plane for planar).
+ *
+ * e.g:
+ * yuv422::convert_line<yuv422::v210, yuv422::planar>(src, dst, 1920);
+ */
+namespace yuv422
+{
+
+/// Pixels converted at a time: a whole number of groups for every layout (v210 groups hold 6 pixels, packed10 blocks stay byte-aligned).
+constexpr size_t block_px = 192;
+
+/// Frame description, one pointer & stride (in bytes) per plane. Interleaved layouts only use the first plane, planar uses Y, Cb, Cr.
+template<typename T>
+struct frame_t
+{
+  T* data[3];
+  size_t stride[3];
+};
+
+// Every layout provides:
+//  . line_size(width): number of bytes of a line (of the luma plane for planar)
+//  . load(line, px, n, s): decodes n pixels starting at pixel px into 2*n interleaved samples
+//  . store(line, px, n, s): encodes n pixels starting at pixel px from 2*n interleaved samples
+// px is always a multiple of block_px.
+
+/// Big-endian packed 10-bit, see tb_reader.
+struct packed10
+{
+  static inline size_t line_size(size_t width) { return (width * 20 + 7) / 8; }
+
+  static inline void load(const uint8_t* const l[3], size_t px, size_t n, uint16_t* s)
+  {
+    tb_reader(l[0]).unpack(s, px * 2, n * 2);
+  }
+
+  static inline void store(uint8_t* const l[3], size_t px, size_t n, const uint16_t* s)
+  {
+    tb_writer(l[0]).pack(s, px * 2, n * 2);
+  }
+};
+
+/// Kernels of the v210 layout, working on whole groups (4 words, 12 samples).
+namespace v210_kernel
+{
+
+inline void load(const uint8_t* p, uint16_t* s, size_t groups)
+{
+  for (size_t g=0; g < groups; ++g, p += 16, s += 12)
+  {
+    for (size_t w=0; w < 4; ++w)
+    {
+      const uint32_t v = load_le32(p + w * 4);
+      s[w*3]   = static_cast<uint16_t>(v & 0x3ff);
+      s[w*3+1] = static_cast<uint16_t>((v >> 10) & 0x3ff);
+      s[w*3+2] = static_cast<uint16_t>((v >> 20) & 0x3ff);
+    }
+  }
+}
+
+inline void store(uint8_t* p, const uint16_t* s, size_t groups)
+{
+  for (size_t g=0; g < groups; ++g, p += 16, s += 12)
+  {
+    for (size_t w=0; w < 4; ++w)
+    {
+      store_le32(p + w * 4, static_cast<uint32_t>(s[w*3] & 0x3ff) |
+                            static_cast<uint32_t>(s[w*3+1] & 0x3ff) << 10 |
+                            static_cast<uint32_t>(s[w*3+2] & 0x3ff) << 20);
+    }
+  }
+}
+
+#ifdef BITREAD_X86
+// Decoding: each 16-bit lane gathers the 2 bytes holding its sample, which then sits at bit 0, 2 or 4 of the lane.
+// As in tb_unpack, a multiplication by 16, 4 or 1 followed by a constant shift replaces the per-lane variable shift.
+__attribute__((target("ssse3")))
+inline void load_ssse3(const uint8_t* p, uint16_t* s, size_t groups)
+{
+  const __m128i shuf_lo = _mm_setr_epi8(0,1, 1,2, 2,3, 4,5, 5,6, 6,7, 8,9, 9,10);                  // samples 0 to 7
+  const __m128i shuf_hi = _mm_setr_epi8(10,11, 12,13, 13,14, 14,15, -1,-1, -1,-1, -1,-1, -1,-1); // samples 8 to 11
+  const __m128i mul_lo  = _mm_setr_epi16(16,4,1, 16,4,1, 16,4);
+  const __m128i mul_hi  = _mm_setr_epi16(1, 16,4,1, 0,0,0,0);
+  const __m128i mask    = _mm_set1_epi16(0x3ff);
+
+  for (size_t g=0; g < groups; ++g, p += 16, s += 12)
+  {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i lo = _mm_and_si128(_mm_srli_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(v, shuf_lo), mul_lo), 4), mask);
+    const __m128i hi = _mm_and_si128(_mm_srli_epi16(_mm_mullo_epi16(_mm_shuffle_epi8(v, shuf_hi), mul_hi), 4), mask);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(s), lo);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(s+8), hi);
+  }
+}
+
+// Encoding: the 1st & 2nd samples of each word are merged by a multiply-add (s0 + s1*1024), the 3rd one is shifted in place.
+// Samples are read as 2 overlapping vectors (0 to 7 and 4 to 11) and gathered in their 32-bit lane with byte shuffles.
+__attribute__((target("ssse3")))
+inline void store_ssse3(uint8_t* p, const uint16_t* s, size_t groups)
+{
+  const __m128i pair_lo  = _mm_setr_epi8(0,1,2,3, 6,7,8,9, -1,-1,-1,-1, -1,-1,-1,-1);          // (s0,s1) (s3,s4) from s0..s7
+  const __m128i pair_hi  = _mm_setr_epi8(-1,-1,-1,-1, -1,-1,-1,-1, 4,5,6,7, 10,11,12,13);      // (s6,s7) (s9,s10) from s4..s11
+  const __m128i third_lo = _mm_setr_epi8(4,5,-1,-1, 10,11,-1,-1, -1,-1,-1,-1, -1,-1,-1,-1);    // s2 s5 from s0..s7
+  const __m128i third_hi = _mm_setr_epi8(-1,-1,-1,-1, -1,-1,-1,-1, 8,9,-1,-1, 14,15,-1,-1);    // s8 s11 from s4..s11
+  const __m128i madd     = _mm_set1_epi32(0x04000001); // (1, 1024)
+  const __m128i mask     = _mm_set1_epi16(0x3ff);
+
+  for (size_t g=0; g < groups; ++g, p += 16, s += 12)
+  {
+    const __m128i lo = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s)), mask);
+    const __m128i hi = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s+4)), mask);
+    const __m128i pairs = _mm_or_si128(_mm_shuffle_epi8(lo, pair_lo), _mm_shuffle_epi8(hi, pair_hi));
+    const __m128i third = _mm_or_si128(_mm_shuffle_epi8(lo, third_lo), _mm_shuffle_epi8(hi, third_hi));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_or_si128(_mm_madd_epi16(pairs, madd), _mm_slli_epi32(third, 20)));
+  }
+}
+#endif
+
+} // v210_kernel
+
+/// v210: 6 pixels (12 samples) per 16-byte group.
+struct v210
+{
+  static inline size_t line_size(size_t width) { return (width + 47) / 48 * 128; }
+
+  static inline void load(const uint8_t* const l[3], size_t px, size_t n, uint16_t* s)
+  {
+    // the padding of the last group is decoded as well: s must hold a whole number of groups
+    const uint8_t* p = l[0] + px / 6 * 16;
+    const size_t groups = (n + 5) / 6;
+#ifdef BITREAD_X86
+    if (simd_detect() >= simd_level::ssse3) return v210_kernel::load_ssse3(p, s, groups);
+#endif
+    v210_kernel::load(p, s, groups);
+  }
+
+  static inline void store(uint8_t* const l[3], size_t px, size_t n, const uint16_t* s)
+  {
+    uint8_t* p = l[0] + px / 6 * 16;
+    const size_t groups = n / 6;
+#ifdef BITREAD_X86
+    if (simd_detect() >= simd_level::ssse3) v210_kernel::store_ssse3(p, s, groups);
+    else
+#endif
+    v210_kernel::store(p, s, groups);
+
+    // last partial group, padded with 0
+    if (n % 6)
+    {
+      uint16_t last[12] = {0};
+      std::copy(s + groups * 12, s + n * 2, last);
+      v210_kernel::store(p + groups * 16, last, 1);
+    }
+  }
+};
+
+/// One sample per 16-bit word.
+struct uyvy16
+{
+  static inline size_t line_size(size_t width) { return width * 4; }
+
+  static inline void load(const uint8_t* const l[3], size_t px, size_t n, uint16_t* s)
+  {
+    std::memcpy(s, l[0] + px * 4, n * 4);
+  }
+
+  static inline void store(uint8_t* const l[3], size_t px, size_t n, const uint16_t* s)
+  {
+    std::memcpy(l[0] + px * 4, s, n * 4);
+  }
+};
+
+/// One 16-bit plane per component.
+struct planar
+{
+  static inline size_t line_size(size_t width) { return width * 2; }
+
+  /// interleaves Cb Y Cr Y
+  static inline void load(const uint8_t* const l[3], size_t px, size_t n, uint16_t* s)
+  {
+    const uint16_t* y  = reinterpret_cast<const uint16_t*>(l[0]) + px;
+    const uint16_t* cb = reinterpret_cast<const uint16_t*>(l[1]) + px / 2;
+    const uint16_t* cr = reinterpret_cast<const uint16_t*>(l[2]) + px / 2;
+
+    size_t i = 0;
+#ifdef __SSE2__
+    // 8 pixels per iteration
+    for (; i + 8 <= n; i += 8)
+    {
+      const __m128i vy  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i));
+      const __m128i vc  = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cb + i/2)),
+                                             _mm_loadl_epi64(reinterpret_cast<const __m128i*>(cr + i/2))); // Cb Cr Cb Cr ...
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(s + i*2),   _mm_unpacklo_epi16(vc, vy));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(s + i*2+8), _mm_unpackhi_epi16(vc, vy));
+    }
+#endif
+    for (; i < n; i += 2)
+    {
+      s[i*2]   = cb[i/2];
+      s[i*2+1] = y[i];
+      s[i*2+2] = cr[i/2];
+      s[i*2+3] = y[i+1];
+    }
+  }
+
+  /// de-interleaves Cb Y Cr Y
+  static inline void store(uint8_t* const l[3], size_t px, size_t n, const uint16_t* s)
+  {
+    uint16_t* y  = reinterpret_cast<uint16_t*>(l[0]) + px;
+    uint16_t* cb = reinterpret_cast<uint16_t*>(l[1]) + px / 2;
+    uint16_t* cr = reinterpret_cast<uint16_t*>(l[2]) + px / 2;
+
+    size_t i = 0;
+#ifdef __SSE2__
+    // 16 pixels per iteration: odd lanes are luma, even lanes alternate Cb & Cr.
+    // Samples are masked to 10 bits, which keeps the signed saturation of packs_epi32 out of the way.
+    const __m128i mask = _mm_set1_epi32(0x3ff);
+    for (; i + 16 <= n; i += 16)
+    {
+      __m128i v[4];
+      for (size_t k=0; k < 4; ++k) v[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i*2 + k*8));
+
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(y + i),   _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(v[0], 16), mask), _mm_and_si128(_mm_srli_epi32(v[1], 16), mask)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(y + i+8), _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(v[2], 16), mask), _mm_and_si128(_mm_srli_epi32(v[3], 16), mask)));
+
+      const __m128i c0 = _mm_packs_epi32(_mm_and_si128(v[0], mask), _mm_and_si128(v[1], mask)); // Cb Cr Cb Cr ...
+      const __m128i c1 = _mm_packs_epi32(_mm_and_si128(v[2], mask), _mm_and_si128(v[3], mask));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(cb + i/2), _mm_packs_epi32(_mm_and_si128(c0, mask), _mm_and_si128(c1, mask)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(cr + i/2), _mm_packs_epi32(_mm_srli_epi32(c0, 16), _mm_srli_epi32(c1, 16)));
+    }
+#endif
+    for (; i < n; i += 2)
+    {
+      cb[i/2]  = s[i*2] & 0x3ff;
+      y[i]     = s[i*2+1] & 0x3ff;
+      cr[i/2]  = s[i*2+2] & 0x3ff;
+      y[i+1]   = s[i*2+3] & 0x3ff;
+    }
+  }
+};
+
+/// Converts a line of width pixels from the Src layout to the Dst layout.
+/// src & dst hold one pointer per plane (see frame_t).
+template<typename Src, typename Dst>
+inline void convert_line(const uint8_t* const src[3], uint8_t* const dst[3], size_t width)
+{
+  alignas(64) uint16_t s[block_px * 2];
+
+  for (size_t px = 0; px < width; px += block_px)
+  {
+    const size_t n = std::min(block_px, width - px);
+    Src::load(src, px, n, s);
+    Dst::store(dst, px, n, s);
+  }
+}
+
+/// Converts a whole frame from the Src layout to the Dst layout, lines being spread across threads.
+/// Lines are converted in parallel with OpenMP: targets including this header link OpenMP::OpenMP_CXX, otherwise the frame is
+/// converted by the calling thread alone.
+template<typename Src, typename Dst>
+inline void convert_frame(const frame_t<const uint8_t>& src, const frame_t<uint8_t>& dst, size_t width, size_t height)
+{
+#ifdef _OPENMP
+  #pragma omp parallel for schedule(static)
+#endif
+  for (long l = 0; l < static_cast<long>(height); ++l)
+  {
+    const uint8_t* sl[3];
+    uint8_t* dl[3];
+    for (size_t k=0; k < 3; ++k)
+    {
+      sl[k] = src.data[k] ? src.data[k] + l * src.stride[k] : nullptr;
+      dl[k] = dst.data[k] ? dst.data[k] + l * dst.stride[k] : nullptr;
+    }
+    convert_line<Src, Dst>(sl, dl, width);
+  }
+}
+
+} // yuv422
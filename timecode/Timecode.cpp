@@ -1,12 +1,18 @@
-#include <timecode.h>
+#include "Timecode.h"
 
+#include <algorithm>
 #include <cmath>
+#include <iterator>
+#include <limits>
 #include <stdexcept>
 #include <sstream>
-#include <regex>
+#include <thread>
+#include <vector>
 
-using int128_t = __int128;
-using uint128_t = unsigned __int128;
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TIMECODE_X86 1
+#endif
 
 const timecode_t::rate_t timecode_t::RATE_FILM{24,false};
 const timecode_t::rate_t timecode_t::RATE_PAL{25,false};
@@ -33,15 +39,15 @@ std::ostream& operator<<(std::ostream& os, const timecode_t::rate_t& dt)
   return os;
 }
 
-timecode_t::Timecode(const timecode_t::rate_t& framerate, uint64_t frames)
+timecode_t::timecode_t(const timecode_t::rate_t& framerate, uint64_t frames)
 {
   set_framerate(framerate);
   set_framecount(frames);
 }
 
-Timecode timecode_t::from_string(const std::string& s)
+timecode_t timecode_t::from_string(const std::string& s)
 {
-  Timecode tc;
+  timecode_t tc;
   tc.set_str(s);
   return tc;
 }
@@ -69,7 +75,12 @@ void timecode_t::verify() const
 
 bool timecode_t::is_valid() const
 {
-  return error().empty();
+  return is_valid(_d);
+}
+
+bool timecode_t::is_valid(const components_t& d) const
+{
+  return d.ff < _framerate.fps && d.ss < 60 && d.mm < 60 && d.hh < 24;
 }
 
 std::string timecode_t::error() const
@@ -106,252 +117,733 @@ timecode_t::rate_t timecode_t::framerate() const
   return _framerate;
 }
 
-Timecode& timecode_t::set_st12(uint32_t v)
+namespace
 {
-  static auto bcd2uint = [](uint8_t bcd) -> unsigned
-  {
-    unsigned low  = bcd & 0xf;
-    unsigned high = bcd >> 4;
-    if (low > 9 || high > 9) return 0;
-    return low + 10*high;
-  };
 
+/// @returns the value of a 2-digit BCD byte, 0 if it isn't valid
+inline unsigned bcd2uint(unsigned bcd)
+{
+  unsigned low  = bcd & 0xf;
+  unsigned high = bcd >> 4;
+  return (low > 9 || high > 9) ? 0 : low + 10*high;
+}
+
+/// SMPTE ST-12 word to components (the day being 0), for a rate of fps frames per second
+inline timecode_detail::components_t st12_decode(uint32_t v, uint64_t fps)
+{
   auto ff = bcd2uint(v>>24 & 0x3f);  // 6-bit frames
-  if (_framerate.fps > 30)
+  if (fps > 30)
   {
       ff <<= 1;
-      if (_framerate.fps == 50) ff += !!(v & 1 << 7);
-      else ff += !!(v & 1 << 23);
+      ff += v >> (fps == 50 ? 7 : 23) & 1;
   }
 
   auto ss = bcd2uint(v>>16 & 0x7f); // 7-bit seconds
   auto mm = bcd2uint(v>>8 & 0x7f); // 7-bit minutes
   auto hh = bcd2uint(v & 0x3f); // 6-bit hours
 
-  _d.dd = 0;
-  _d.hh = hh;
-  _d.mm = mm;
-  _d.ss = ss;
-  _d.ff = ff;
-
-  return *this;
+  return timecode_detail::components_t{static_cast<uint16_t>(ff), static_cast<uint16_t>(ss), static_cast<uint16_t>(mm), static_cast<uint16_t>(hh), 0};
 }
 
-uint32_t timecode_t::st12() const
+/// Components to SMPTE ST-12 word (the day being ignored), for a rate of fps frames per second
+inline uint32_t st12_encode(const timecode_detail::components_t& d, uint64_t fps, bool drop)
 {
   uint32_t r=0;
-  auto ff = _d.ff;
+  uint32_t ff = d.ff;
   // For SMPTE 12-M timecodes, frame count is a special case if > 30 FPS.
   // See SMPTE ST 12-1:2014 Sec 12.1 for more info.
-  if (_framerate.fps > 30)
+  if (fps > 30)
   {
-    if (_d.ff%2 == 1)
-    {
-      if (_framerate.fps == 50) r |= (1 << 7);
-      else r |= (1 << 23);
-    }
+    r |= (ff % 2) << (fps == 50 ? 7 : 23);
     ff /= 2;
   }
 
-  r |= _framerate.drop << 30;
+  r |= static_cast<uint32_t>(drop) << 30;
   r |= (ff / 10) << 28;
   r |= (ff % 10) << 24;
-  r |= (_d.ss / 10) << 20;
-  r |= (_d.ss % 10) << 16;
-  r |= (_d.mm / 10) << 12;
-  r |= (_d.mm % 10) << 8;
-  r |= (_d.hh / 10) << 4;
-  r |= (_d.hh % 10);
+  r |= static_cast<uint32_t>(d.ss / 10) << 20;
+  r |= static_cast<uint32_t>(d.ss % 10) << 16;
+  r |= static_cast<uint32_t>(d.mm / 10) << 12;
+  r |= static_cast<uint32_t>(d.mm % 10) << 8;
+  r |= static_cast<uint32_t>(d.hh / 10) << 4;
+  r |= static_cast<uint32_t>(d.hh % 10);
 
   return r;
 }
 
-timecode_t& timecode_t::set_framecount(uint64_t v)
-{
-  uint64_t frames = v;
-
-  if (_framerate.drop)
-  {
-    // Count the number of 10 minutes time-spans comprised in this timecode.
-    const uint64_t ten_minutes_group_cnt = static_cast<uint64_t>(static_cast<long double>(frames) / static_cast<long double>(_frames_per.ten_minute));
-    // Count remaining frames.
-    const uint64_t remaining_frames = frames % static_cast<int64_t>(_frames_per.ten_minute);
-    // Count remaining minutes.
-    // Note: We remove _droppedFramesPerMinute from remainingFrames.
-    //       This is due to the fact that every 10 minute, one minute is longer than the others by _droppedFramesPerMinute frames.
-    const int64_t remaining_minutes = static_cast<int64_t>(static_cast<long double>(remaining_frames - _frames_per.minute_dropped) / static_cast<long double>(_frames_per.minute_real));
-    // Restore dropped frames.
-    const uint128_t dropped_frames = static_cast<uint128_t>(_frames_per.minute_dropped) * static_cast<uint128_t>(9 * ten_minutes_group_cnt + remaining_minutes);
-    frames += dropped_frames;
-  }
+} // namespace
 
-  // Update number of days.
-  _d.dd = static_cast<decltype(_d.dd)>(static_cast<long double>(frames) / static_cast<long double>(_frames_per.day));
-  frames -= _d.dd * _frames_per.day;
-
-  // Update number of hours.
-  _d.hh = static_cast<decltype(_d.hh)>(static_cast<long double>(frames) / static_cast<long double>(_frames_per.hour));
-  frames -= _d.hh * _frames_per.hour;
-
-  // Update number of minutes.
-  _d.mm = static_cast<decltype(_d.mm)>(static_cast<long double>(frames) / _frames_per.minute);
-  frames -= _d.mm * _frames_per.minute;
+timecode_t& timecode_t::set_st12(uint32_t v)
+{
+  _d = st12_decode(v, _framerate.fps);
+  return *this;
+}
 
-  // Update number of seconds.
-  _d.ss = static_cast<decltype(_d.ss)>(static_cast<long double>(frames) / _frames_per.second);
-  frames -= _d.ss * _frames_per.second;
+uint32_t timecode_t::st12() const
+{
+  return st12_encode(_d, _framerate.fps, _framerate.drop);
+}
 
-  // Update number of frames.
-  _d.ff = static_cast<decltype(_d.ff)>(frames);
+template<typename F>
+auto timecode_t::with_frames_per(F&& f) const
+{
+  switch (_framerate.fps * 2 + _framerate.drop)
+  {
+  case 24*2:   return f(timecode_detail::frames_per_c<24,false>{});
+  case 25*2:   return f(timecode_detail::frames_per_c<25,false>{});
+  case 30*2:   return f(timecode_detail::frames_per_c<30,false>{});
+  case 30*2+1: return f(timecode_detail::frames_per_c<30,true>{});
+  case 50*2:   return f(timecode_detail::frames_per_c<50,false>{});
+  case 60*2:   return f(timecode_detail::frames_per_c<60,false>{});
+  case 60*2+1: return f(timecode_detail::frames_per_c<60,true>{});
+  default:     return f(_frames_per);
+  }
+}
 
+timecode_t& timecode_t::set_framecount(uint64_t v)
+{
+  with_frames_per([&](const auto& r) { timecode_detail::decompose(r, v, _d); });
   return *this;
 }
 
 uint64_t timecode_t::framecount() const
 {
-  uint64_t result = 0;
+  return with_frames_per([&](const auto& r) { return timecode_detail::compose(r, _d); });
+}
 
-  // May be updated depending on the drop-frame flag.
-  auto frame = _d.ff;
+template<typename R>
+bool timecode_t::canonical(const R& r, const components_t& d)
+{
+  return d.ff < r.second && d.ss < 60 && d.mm < 60 && d.hh < 24 &&
+         !(r.minute_dropped && d.ss == 0 && d.ff < r.minute_dropped && (d.mm % 10) != 0);
+}
 
-  if (_framerate.drop)
+template<typename R>
+void timecode_t::increment(const R& r, components_t& d)
+{
+  if (!canonical(r, d))
   {
-    if (_d.ss == 0 &&
-        frame < _frames_per.minute_dropped &&
-        (_d.mm % 10) != 0)
-    {
-      // Except every ten minutes:
-      //  . 30DF: Frames 00, 01 and 02 are mapped to the same actual video frame.
-      //  . 60DF: Frames 00, 01, 02, 03 and 04 are mapped to the same actual video frame.
-      frame = _frames_per.minute_dropped;
-    }
+    timecode_detail::decompose(r, timecode_detail::compose(r, d) + 1, d);
+    return;
+  }
+
+  if (++d.ff < r.second) return;
+  d.ff = 0;
+  if (++d.ss < 60) return;
+  d.ss = 0;
+  if (++d.mm < 60)
+  {
+    // drop-frame: the first frame numbers of each minute are skipped, except every ten minutes
+    if ((d.mm % 10) != 0) d.ff = static_cast<uint16_t>(r.minute_dropped);
+    return;
+  }
+  d.mm = 0;
+  if (++d.hh < 24) return;
+  d.hh = 0;
+  ++d.dd;
+}
+
+template<typename R>
+void timecode_t::decrement(const R& r, components_t& d)
+{
+  if (!canonical(r, d) || (d.dd | d.hh | d.mm | d.ss | d.ff) == 0)
+  {
+    timecode_detail::decompose(r, timecode_detail::compose(r, d) - 1, d);
+    return;
+  }
 
-    // Compute the number of minutes in this timecode.
-    auto minutes_count = (_d.dd * 1440) + (_d.hh * 60) + _d.mm;
-    if (minutes_count > 0)
+  // first frame of the minute (the drop-frame frame numbers skipped at the beginning of most minutes excluded)
+  const uint64_t first = (d.ss == 0 && (d.mm % 10) != 0) ? r.minute_dropped : 0;
+  if (d.ff > first)
+  {
+    --d.ff;
+    return;
+  }
+  d.ff = static_cast<uint16_t>(r.second - 1);
+  if (d.ss-- > 0) return;
+  d.ss = 59;
+  if (d.mm-- > 0) return;
+  d.mm = 59;
+  if (d.hh-- > 0) return;
+  d.hh = 23;
+  --d.dd;
+}
+
+template<typename R>
+void timecode_t::advance(const R& r, components_t& d, int64_t n)
+{
+  const int64_t minute = static_cast<int64_t>(r.minute);
+  if (n > -minute && n < minute && canonical(r, d))
+  {
+    // frame numbers valid within the current minute: [first; minute[
+    const int64_t first = (r.minute_dropped && (d.mm % 10) != 0) ? static_cast<int64_t>(r.minute_dropped) : 0;
+    const int64_t pos = static_cast<int64_t>(d.ss * r.second + d.ff) + n;
+    if (pos >= first && pos < minute)
     {
-      // Compensate for each dropped frames per minute (except for the ones kept every ten minute).
-      result -= _frames_per.minute_dropped * (minutes_count - static_cast<decltype(result)>(static_cast<double>(minutes_count) / 10.));
+      d.ss = static_cast<uint16_t>(static_cast<uint64_t>(pos) / r.second);
+      d.ff = static_cast<uint16_t>(static_cast<uint64_t>(pos) % r.second);
+      return;
     }
   }
 
-  // Add timecode withtout taking account of the drop value (which was compensated just before).
-  // Factorization from:
-  // result += frame + (sec * rate) + (min * 60 * rate) + (hour * 60 * 60 * rate) + (day * 60 * 60 * 24 * rate)
-  // Note: The current result is a frame index (0-based) and not a frame count (1-based) => Append 1 to the result;
-  result += (frame + _framerate.fps * (_d.ss + 60 * (_d.mm + 60 * (_d.hh + 24 * _d.dd)))) + 1;
+  timecode_detail::decompose(r, timecode_detail::compose(r, d) + static_cast<uint64_t>(n), d);
+}
 
-  return result-1;
+timecode_t& timecode_t::advance(int64_t n)
+{
+  with_frames_per([&](const auto& r) { advance(r, _d, n); });
+  return *this;
 }
 
 timecode_t timecode_t::operator+(int64_t fc) const
 {
-  return Timecode{_framerate,framecount()+fc};
+  timecode_t r{*this};
+  return r.advance(fc);
 }
 
 timecode_t& timecode_t::operator++()
 {
-  set_framecount(framecount()+1);
+  with_frames_per([&](const auto& r) { increment(r, _d); });
   return *this;
 }
 
 timecode_t timecode_t::operator++(int) const
 {
-  return Timecode(_framerate,framecount()+1);
+  timecode_t r{*this};
+  return ++r;
 }
 
 timecode_t& timecode_t::operator+=(int64_t fc)
 {
-  set_framecount(framecount() + fc);
-  return *this;
+  return advance(fc);
 }
 
 timecode_t timecode_t::operator-(int64_t fc) const
 {
-  return Timecode{_framerate,framecount()-fc};
+  timecode_t r{*this};
+  return r.advance(-fc);
 }
 
 timecode_t& timecode_t::operator--()
 {
-  set_framecount(framecount()-1);
+  with_frames_per([&](const auto& r) { decrement(r, _d); });
   return *this;
 }
 
 timecode_t timecode_t::operator--(int) const
 {
-  return Timecode(_framerate,framecount()-1);
+  timecode_t r{*this};
+  return --r;
 }
 
 timecode_t& timecode_t::operator-=(int64_t v)
 {
-  set_framecount(framecount()-v);
-  return *this;
+  return advance(-v);
 }
 
-timecode_t timecode_t::operator-(const Timecode& o) const
+timecode_t timecode_t::operator-(const timecode_t& o) const
 {
-  return Timecode{_framerate, framecount()-o.framecount()};
+  return timecode_t{_framerate, framecount()-o.framecount()};
 }
 
 std::string timecode_t::str() const
 {
-  // FIXME: use stl
-  auto pad = [](uint64_t n, size_t w, const std::string& c) -> std::string
+  char buf[MAX_STR_SIZE];
+  return std::string(buf, to_chars(buf, buf + sizeof(buf)).ptr);
+}
+
+std::to_chars_result timecode_t::to_chars(char* first, char* last) const
+{
+  char* p = first;
+  // at least 2 digits
+  auto put = [&](uint16_t v)
+  {
+    if (v < 100 && last - p >= 2)
+    {
+      p[0] = static_cast<char>('0' + v / 10);
+      p[1] = static_cast<char>('0' + v % 10);
+      p += 2;
+      return true;
+    }
+    const auto r = std::to_chars(p, last, v);
+    p = r.ptr;
+    return v >= 100 && r.ec == std::errc{};
+  };
+  auto sep = [&](char c)
   {
-    auto result = std::to_string(n);
-    while (result.size() < w) result = c + result;
-    return result;
+    if (p == last) return false;
+    *p++ = c;
+    return true;
   };
 
-  return pad(_d.hh  ,2,"0") + ':' +
-         pad(_d.mm,2,"0") + ':' +
-         pad(_d.ss,2,"0") + (_framerate.drop ? ';' : ':') +
-      pad(_d.ff ,2,"0");
+  if (put(_d.hh) && sep(':') &&
+      put(_d.mm) && sep(':') &&
+      put(_d.ss) && sep(_framerate.drop ? ';' : ':') &&
+      put(_d.ff))
+  {
+    return {p, std::errc{}};
+  }
+  return {last, std::errc::value_too_large};
+}
+
+namespace
+{
+
+/// Parses the 2 decimal digits at p into v
+inline bool parse_2digits(const char* p, uint16_t& v)
+{
+  const unsigned high = static_cast<unsigned>(p[0] - '0');
+  const unsigned low  = static_cast<unsigned>(p[1] - '0');
+  if (high > 9 || low > 9) return false;
+  v = static_cast<uint16_t>(high * 10 + low);
+  return true;
 }
 
-timecode_t& timecode_t::set_str(const std::string& s)
+} // namespace
+
+std::from_chars_result timecode_t::parse(const char* first, const char* last, components_t& d)
 {
-  std::regex rx{"^([0-9]{2}):([0-9]{2}):([0-9]{2})(?::|;)([0-9]{2})"};
-  std::smatch m;
-  if (std::regex_search(s, m, rx))
+  // HH:MM:SS:FF or HH:MM:SS;FF
+  constexpr ptrdiff_t size = 11;
+  if (last - first < size ||
+      !parse_2digits(first, d.hh) || first[2] != ':' ||
+      !parse_2digits(first + 3, d.mm) || first[5] != ':' ||
+      !parse_2digits(first + 6, d.ss) || (first[8] != ':' && first[8] != ';') ||
+      !parse_2digits(first + 9, d.ff))
   {
-    _d.dd = 0;
-    _d.hh = std::stoi(m[1]);
-    _d.mm = std::stoi(m[2]);
-    _d.ss = std::stoi(m[3]);
-    _d.ff = std::stoi(m[4]);
-    verify();
+    return {first, std::errc::invalid_argument};
   }
-  else
+  d.dd = 0;
+  return {first + size, std::errc{}};
+}
+
+std::from_chars_result timecode_t::from_chars(const char* first, const char* last)
+{
+  components_t d{0,0,0,0,0};
+  auto r = parse(first, last, d);
+  if (r.ec != std::errc{}) return r;
+  if (!is_valid(d)) return {r.ptr, std::errc::result_out_of_range};
+  _d = d;
+  return r;
+}
+
+timecode_t& timecode_t::set_str(std::string_view s)
+{
+  components_t d{0,0,0,0,0};
+  if (parse(s.data(), s.data() + s.size(), d).ec != std::errc{})
   {
     throw std::runtime_error{"invalid format"};
   }
+  _d = d;
+  verify();
 
   return *this;
 }
 
 void timecode_t::update_frames_per()
 {
-  _frames_per.second = _framerate.fps;
-  _frames_per.minute = _framerate.fps*60;
-  _frames_per.hour = _framerate.fps*3600; //60*60
-  _frames_per.day = _framerate.fps*86400; //60*60*24
-
-  if (_framerate.drop)
-  {
-    // e.g: In drop-frame mode, there is 30,000*1001 frames per minute instead of 30.
-    _frames_per.minute_real = static_cast<decltype(_frames_per.minute_real)>(
-          (60.*static_cast<double>(_framerate.fps)*1000.) /
-          1001.
-        );
-    // Every ten minutes, the count comes round => Compute the number of lost frames.
-    _frames_per.minute_dropped = 60.0 * static_cast<double>(_framerate.fps) - static_cast<double>(_frames_per.minute_real);
-    _frames_per.ten_minute = 10.0 * static_cast<double>(_frames_per.minute_real) + _frames_per.minute_dropped;
+  const uint64_t fps = _framerate.fps;
+  _frames_per.second = fps;
+  _frames_per.minute = fps*60;
+  _frames_per.hour = fps*3600; //60*60
+  _frames_per.day = fps*86400; //60*60*24
+
+  // e.g: In drop-frame mode, there is 30,000/1001 frames per second instead of 30: 1798 frames per minute (floored).
+  _frames_per.minute_real = _framerate.drop ? (60*fps*1000) / 1001 : _frames_per.minute;
+  // Every ten minutes, the count comes round => Compute the number of lost frames (none in NDF).
+  _frames_per.minute_dropped = _frames_per.minute - _frames_per.minute_real;
+  _frames_per.ten_minute = 10*_frames_per.minute_real + _frames_per.minute_dropped;
+}
+
+namespace
+{
+
+/// Rates of the packed_timecode ids
+constexpr struct { uint16_t fps; bool drop; } packed_rates[] = {
+  {25,false}, {50,false}, {30,false}, {60,false}, {24,false}, {30,true}, {60,true}
+};
+
+} // namespace
+
+packed_timecode::packed_timecode(const timecode_t::rate_t& framerate, uint64_t frames)
+{
+  unsigned id = 0;
+  while (id < std::size(packed_rates) && !(packed_rates[id].fps == framerate.fps && packed_rates[id].drop == framerate.drop)) ++id;
+
+  if (id == std::size(packed_rates))
+  {
+    std::stringstream ss;
+    ss << "Unsupported packed timecode rate: " << framerate;
+    throw std::runtime_error{ss.str()};
   }
-  else
+  if (frames > FRAME_MASK)
   {
-    // There is no dropped frames for a 10 minutes span in this case.
-    _frames_per.minute_dropped = 0;
-    _frames_per.ten_minute = 10.0 * static_cast<double>(_frames_per.minute);
+    throw std::runtime_error{"Invalid packed timecode frame count: " + std::to_string(frames)};
   }
+
+  _v = static_cast<uint64_t>(id) << FRAME_BITS | frames;
+}
+
+timecode_t::rate_t packed_timecode::framerate() const
+{
+  const auto& r = packed_rates[id() < std::size(packed_rates) ? id() : 0];
+  return timecode_t::rate_t{r.fps, r.drop};
+}
+
+timecode_detail::components_t packed_timecode::components() const
+{
+  timecode_detail::components_t d{0,0,0,0,0};
+  switch (id())
+  {
+  case 1:  timecode_detail::decompose(timecode_detail::frames_per_c<50,false>{}, framecount(), d); break;
+  case 2:  timecode_detail::decompose(timecode_detail::frames_per_c<30,false>{}, framecount(), d); break;
+  case 3:  timecode_detail::decompose(timecode_detail::frames_per_c<60,false>{}, framecount(), d); break;
+  case 4:  timecode_detail::decompose(timecode_detail::frames_per_c<24,false>{}, framecount(), d); break;
+  case 5:  timecode_detail::decompose(timecode_detail::frames_per_c<30,true>{}, framecount(), d); break;
+  case 6:  timecode_detail::decompose(timecode_detail::frames_per_c<60,true>{}, framecount(), d); break;
+  default: timecode_detail::decompose(timecode_detail::frames_per_c<25,false>{}, framecount(), d); break;
+  }
+  return d;
+}
+
+namespace
+{
+
+/// Calls f(first, count) over [0; n[, split in chunks run by up to threads threads (the calling thread included)
+template<typename F>
+void parallel_for(size_t n, unsigned threads, F&& f)
+{
+  // below that, starting threads costs more than converting
+  constexpr size_t MIN_CHUNK = 1 << 16;
+  const size_t chunks = std::max<size_t>(1, std::min<size_t>(threads, n / MIN_CHUNK));
+  if (chunks == 1) return f(0, n);
+
+  const size_t chunk = (n + chunks - 1) / chunks;
+  std::vector<std::thread> workers;
+  workers.reserve(chunks - 1);
+  for (size_t ii=1; ii < chunks; ++ii)
+  {
+    workers.emplace_back([&f, ii, chunk, n] { f(ii * chunk, std::min(chunk, n - ii * chunk)); });
+  }
+  f(0, chunk);
+  for (auto& w : workers) w.join();
+}
+
+/// Calls f(i, frames[i]) for i in [0; n[, frames[i] being narrowed to uint32_t for blocks of frame counts below 2^31
+template<typename R, typename F>
+void for_each_framecount(const R& r, const uint64_t* frames, size_t n, F&& f)
+{
+  constexpr size_t BLOCK = 256;
+  const bool narrow_rate = r.day <= std::numeric_limits<uint32_t>::max() / 2;
+  for (size_t first=0; first < n; first += BLOCK)
+  {
+    const size_t last = std::min(n, first + BLOCK);
+    uint64_t all = 0;
+    for (size_t ii=first; ii < last; ++ii) all |= frames[ii];
+
+    if (narrow_rate && all < (static_cast<uint64_t>(1) << 31))
+    {
+      for (size_t ii=first; ii < last; ++ii) f(ii, static_cast<uint32_t>(frames[ii]));
+    }
+    else
+    {
+      for (size_t ii=first; ii < last; ++ii) f(ii, frames[ii]);
+    }
+  }
+}
+
+} // namespace
+
+void timecode_t::framecounts_to_st12(const rate_t& rate, const uint64_t* frames, size_t n, uint32_t* out, unsigned threads)
+{
+  const timecode_t tc{rate};
+  tc.with_frames_per([&](const auto& r)
+  {
+    parallel_for(n, threads, [&](size_t first, size_t count)
+    {
+      for_each_framecount(r, frames + first, count, [&, o = out + first](size_t ii, auto f)
+      {
+        components_t d{0,0,0,0,0};
+        timecode_detail::decompose(r, f, d);
+        o[ii] = st12_encode(d, r.second, rate.drop);
+      });
+    });
+  });
+}
+
+void timecode_t::framecounts_to_components(const rate_t& rate, const uint64_t* frames, size_t n, components_t* out, unsigned threads)
+{
+  const timecode_t tc{rate};
+  tc.with_frames_per([&](const auto& r)
+  {
+    parallel_for(n, threads, [&](size_t first, size_t count)
+    {
+      for_each_framecount(r, frames + first, count, [&, o = out + first](size_t ii, auto f)
+      {
+        timecode_detail::decompose(r, f, o[ii]);
+      });
+    });
+  });
+}
+
+void timecode_t::st12_to_framecounts(const rate_t& rate, const uint32_t* st12, size_t n, uint64_t* out, unsigned threads)
+{
+  const timecode_t tc{rate};
+  tc.with_frames_per([&](const auto& r)
+  {
+    parallel_for(n, threads, [&](size_t first, size_t count)
+    {
+      // ST-12 words hold less than 40 hours
+      if (r.day <= std::numeric_limits<uint32_t>::max() / 2)
+      {
+        for (size_t ii=first; ii < first + count; ++ii) out[ii] = timecode_detail::compose<uint32_t>(r, st12_decode(st12[ii], r.second));
+      }
+      else
+      {
+        for (size_t ii=first; ii < first + count; ++ii) out[ii] = timecode_detail::compose(r, st12_decode(st12[ii], r.second));
+      }
+    });
+  });
+}
+
+timecode_t::isa_t timecode_t::isa_detect()
+{
+  static const isa_t isa = []()
+  {
+#ifdef TIMECODE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return isa_t::avx2;
+    if (__builtin_cpu_supports("sse4.1")) return isa_t::sse41;
+#endif
+    return isa_t::scalar;
+  }();
+  return isa;
+}
+
+namespace
+{
+
+#ifdef TIMECODE_X86
+// ST-12 kernels: a word holds the BCD frames, seconds, minutes and hours from its MSB to its LSB (i.e: hh mm ss ff bytes in memory),
+// components_t holds ff ss mm hh as 16-bit values followed by the 64-bit day.
+
+/// Encodes the ff ss mm hh 16-bit lanes of v (< 100, ff < 200 above 30 FPS) to BCD, adding the field bit above 30 FPS
+__attribute__((target("avx2")))
+inline __m256i st12_bcd_avx2(__m256i v, bool high, __m128i field_shift)
+{
+  __m256i field = _mm256_setzero_si256();
+  if (high)
+  {
+    // LSB of ff to bit 7 of hh (50 FPS) or ss, then ff / 2
+    field = _mm256_sll_epi64(_mm256_and_si256(v, _mm256_set1_epi64x(1)), field_shift);
+    v = _mm256_blend_epi16(v, _mm256_srli_epi16(v, 1), 0x11);
+  }
+  const __m256i tens = _mm256_mulhi_epu16(v, _mm256_set1_epi16(6554)); // v / 10 for v < 16384
+  return _mm256_or_si256(_mm256_add_epi16(v, _mm256_mullo_epi16(tens, _mm256_set1_epi16(6))), field);
+}
+
+__attribute__((target("avx2")))
+void st12_encode_avx2(const timecode_detail::components_t* in, size_t n, uint32_t* out, uint16_t fps, bool drop)
+{
+  const bool high = fps > 30;
+  const __m128i field_shift = _mm_cvtsi32_si128(fps == 50 ? 55 : 23);
+  const __m256i limits = _mm256_set1_epi64x(static_cast<int64_t>(0x0063006300630000ULL | (high ? 199 : 99)));
+  const __m256i reverse = _mm256_setr_epi8(3,2,1,0, 7,6,5,4, 11,10,9,8, 15,14,13,12, 3,2,1,0, 7,6,5,4, 11,10,9,8, 15,14,13,12);
+  const __m256i order = _mm256_setr_epi32(0,4,1,5,2,6,3,7);
+  const __m256i drop_bit = _mm256_set1_epi32(drop ? 1 << 30 : 0);
+
+  size_t ii = 0;
+  for (; ii + 8 <= n; ii += 8)
+  {
+    const __m256i* p = reinterpret_cast<const __m256i*>(in + ii);
+    __m256i a = _mm256_unpacklo_epi64(_mm256_loadu_si256(p), _mm256_loadu_si256(p + 1));     // components 0 2 | 1 3
+    __m256i b = _mm256_unpacklo_epi64(_mm256_loadu_si256(p + 2), _mm256_loadu_si256(p + 3)); // components 4 6 | 5 7
+
+    const __m256i fit = _mm256_and_si256(_mm256_cmpeq_epi16(_mm256_max_epu16(a, limits), limits),
+                                         _mm256_cmpeq_epi16(_mm256_max_epu16(b, limits), limits));
+    if (_mm256_movemask_epi8(fit) != -1)
+    {
+      for (size_t jj=ii; jj < ii + 8; ++jj) out[jj] = st12_encode(in[jj], fps, drop);
+      continue;
+    }
+
+    a = st12_bcd_avx2(a, high, field_shift);
+    b = st12_bcd_avx2(b, high, field_shift);
+    const __m256i w = _mm256_shuffle_epi8(_mm256_packus_epi16(a, b), reverse); // words 0 2 4 6 | 1 3 5 7
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + ii), _mm256_or_si256(_mm256_permutevar8x32_epi32(w, order), drop_bit));
+  }
+  for (; ii < n; ++ii) out[ii] = st12_encode(in[ii], fps, drop);
+}
+
+/// @returns the ST-12 words of w decoded in place: the bytes hold the binary ff ss mm hh values, ff being doubled (plus the field bit)
+/// above 30 FPS. Invalid BCD digits decode as 0.
+__attribute__((target("avx2")))
+inline __m256i st12_unbcd_avx2(__m256i w, bool high, __m128i field_shift)
+{
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  const __m256i nine = _mm256_set1_epi8(9);
+
+  const __m256i b  = _mm256_and_si256(w, _mm256_set1_epi32(0x3f7f7f3f)); // 6-bit frames & hours, 7-bit seconds & minutes
+  const __m256i lo = _mm256_and_si256(b, nibble);
+  const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(b, 4), nibble);
+  const __m256i invalid = _mm256_or_si256(_mm256_cmpgt_epi8(lo, nine), _mm256_cmpgt_epi8(hi, nine));
+  // lo + 10 * hi: hi < 16, so that the 16-bit shift doesn't carry into the next byte
+  __m256i v = _mm256_add_epi8(lo, _mm256_add_epi8(_mm256_add_epi8(hi, hi), _mm256_slli_epi16(hi, 3)));
+  v = _mm256_andnot_si256(invalid, v);
+
+  if (high)
+  {
+    const __m256i field = _mm256_and_si256(_mm256_srl_epi32(w, field_shift), _mm256_set1_epi32(1));
+    v = _mm256_add_epi32(v, _mm256_and_si256(v, _mm256_set1_epi32(static_cast<int>(0xff000000))));
+    v = _mm256_or_si256(v, _mm256_slli_epi32(field, 24));
+  }
+  return v;
+}
+
+__attribute__((target("avx2")))
+void st12_decode_avx2(const uint32_t* in, size_t n, timecode_detail::components_t* out, uint16_t fps)
+{
+  const bool high = fps > 30;
+  const __m128i field_shift = _mm_cvtsi32_si128(fps == 50 ? 7 : 23);
+  const __m256i order = _mm256_setr_epi32(0,2,4,6,1,3,5,7);
+  // word k of each lane to a components_t (ff ss mm hh zero-extended to 16 bits, day 0)
+  const __m256i expand[] = {
+    _mm256_setr_epi8(3,-1,2,-1,1,-1,0,-1, -1,-1,-1,-1,-1,-1,-1,-1, 3,-1,2,-1,1,-1,0,-1, -1,-1,-1,-1,-1,-1,-1,-1),
+    _mm256_setr_epi8(7,-1,6,-1,5,-1,4,-1, -1,-1,-1,-1,-1,-1,-1,-1, 7,-1,6,-1,5,-1,4,-1, -1,-1,-1,-1,-1,-1,-1,-1),
+    _mm256_setr_epi8(11,-1,10,-1,9,-1,8,-1, -1,-1,-1,-1,-1,-1,-1,-1, 11,-1,10,-1,9,-1,8,-1, -1,-1,-1,-1,-1,-1,-1,-1),
+    _mm256_setr_epi8(15,-1,14,-1,13,-1,12,-1, -1,-1,-1,-1,-1,-1,-1,-1, 15,-1,14,-1,13,-1,12,-1, -1,-1,-1,-1,-1,-1,-1,-1),
+  };
+
+  size_t ii = 0;
+  for (; ii + 8 <= n; ii += 8)
+  {
+    __m256i v = st12_unbcd_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + ii)), high, field_shift);
+    v = _mm256_permutevar8x32_epi32(v, order); // words 0 2 4 6 | 1 3 5 7
+    __m256i* p = reinterpret_cast<__m256i*>(out + ii);
+    for (size_t k=0; k < 4; ++k) _mm256_storeu_si256(p + k, _mm256_shuffle_epi8(v, expand[k]));
+  }
+  for (; ii < n; ++ii) out[ii] = st12_decode(in[ii], fps);
+}
+
+/// Same as above, 4 words at a time
+__attribute__((target("sse4.1")))
+inline __m128i st12_bcd_sse41(__m128i v, bool high, __m128i field_shift)
+{
+  __m128i field = _mm_setzero_si128();
+  if (high)
+  {
+    field = _mm_sll_epi64(_mm_and_si128(v, _mm_set1_epi64x(1)), field_shift);
+    v = _mm_blend_epi16(v, _mm_srli_epi16(v, 1), 0x11);
+  }
+  const __m128i tens = _mm_mulhi_epu16(v, _mm_set1_epi16(6554));
+  return _mm_or_si128(_mm_add_epi16(v, _mm_mullo_epi16(tens, _mm_set1_epi16(6))), field);
+}
+
+__attribute__((target("sse4.1")))
+void st12_encode_sse41(const timecode_detail::components_t* in, size_t n, uint32_t* out, uint16_t fps, bool drop)
+{
+  const bool high = fps > 30;
+  const __m128i field_shift = _mm_cvtsi32_si128(fps == 50 ? 55 : 23);
+  const __m128i limits = _mm_set1_epi64x(static_cast<int64_t>(0x0063006300630000ULL | (high ? 199 : 99)));
+  const __m128i reverse = _mm_setr_epi8(3,2,1,0, 7,6,5,4, 11,10,9,8, 15,14,13,12);
+  const __m128i drop_bit = _mm_set1_epi32(drop ? 1 << 30 : 0);
+
+  size_t ii = 0;
+  for (; ii + 4 <= n; ii += 4)
+  {
+    const __m128i* p = reinterpret_cast<const __m128i*>(in + ii);
+    __m128i a = _mm_unpacklo_epi64(_mm_loadu_si128(p), _mm_loadu_si128(p + 1));     // components 0 1
+    __m128i b = _mm_unpacklo_epi64(_mm_loadu_si128(p + 2), _mm_loadu_si128(p + 3)); // components 2 3
+
+    const __m128i fit = _mm_and_si128(_mm_cmpeq_epi16(_mm_max_epu16(a, limits), limits),
+                                      _mm_cmpeq_epi16(_mm_max_epu16(b, limits), limits));
+    if (_mm_movemask_epi8(fit) != 0xffff)
+    {
+      for (size_t jj=ii; jj < ii + 4; ++jj) out[jj] = st12_encode(in[jj], fps, drop);
+      continue;
+    }
+
+    a = st12_bcd_sse41(a, high, field_shift);
+    b = st12_bcd_sse41(b, high, field_shift);
+    const __m128i w = _mm_shuffle_epi8(_mm_packus_epi16(a, b), reverse);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + ii), _mm_or_si128(w, drop_bit));
+  }
+  for (; ii < n; ++ii) out[ii] = st12_encode(in[ii], fps, drop);
+}
+
+__attribute__((target("sse4.1")))
+inline __m128i st12_unbcd_sse41(__m128i w, bool high, __m128i field_shift)
+{
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+  const __m128i nine = _mm_set1_epi8(9);
+
+  const __m128i b  = _mm_and_si128(w, _mm_set1_epi32(0x3f7f7f3f));
+  const __m128i lo = _mm_and_si128(b, nibble);
+  const __m128i hi = _mm_and_si128(_mm_srli_epi16(b, 4), nibble);
+  const __m128i invalid = _mm_or_si128(_mm_cmpgt_epi8(lo, nine), _mm_cmpgt_epi8(hi, nine));
+  __m128i v = _mm_add_epi8(lo, _mm_add_epi8(_mm_add_epi8(hi, hi), _mm_slli_epi16(hi, 3)));
+  v = _mm_andnot_si128(invalid, v);
+
+  if (high)
+  {
+    const __m128i field = _mm_and_si128(_mm_srl_epi32(w, field_shift), _mm_set1_epi32(1));
+    v = _mm_add_epi32(v, _mm_and_si128(v, _mm_set1_epi32(static_cast<int>(0xff000000))));
+    v = _mm_or_si128(v, _mm_slli_epi32(field, 24));
+  }
+  return v;
+}
+
+__attribute__((target("sse4.1")))
+void st12_decode_sse41(const uint32_t* in, size_t n, timecode_detail::components_t* out, uint16_t fps)
+{
+  const bool high = fps > 30;
+  const __m128i field_shift = _mm_cvtsi32_si128(fps == 50 ? 7 : 23);
+  const __m128i expand[] = {
+    _mm_setr_epi8(3,-1,2,-1,1,-1,0,-1, -1,-1,-1,-1,-1,-1,-1,-1),
+    _mm_setr_epi8(7,-1,6,-1,5,-1,4,-1, -1,-1,-1,-1,-1,-1,-1,-1),
+    _mm_setr_epi8(11,-1,10,-1,9,-1,8,-1, -1,-1,-1,-1,-1,-1,-1,-1),
+    _mm_setr_epi8(15,-1,14,-1,13,-1,12,-1, -1,-1,-1,-1,-1,-1,-1,-1),
+  };
+
+  size_t ii = 0;
+  for (; ii + 4 <= n; ii += 4)
+  {
+    const __m128i v = st12_unbcd_sse41(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + ii)), high, field_shift);
+    __m128i* p = reinterpret_cast<__m128i*>(out + ii);
+    for (size_t k=0; k < 4; ++k) _mm_storeu_si128(p + k, _mm_shuffle_epi8(v, expand[k]));
+  }
+  for (; ii < n; ++ii) out[ii] = st12_decode(in[ii], fps);
+}
+#endif
+
+} // namespace
+
+void timecode_t::components_to_st12(const rate_t& rate, const components_t* in, size_t n, uint32_t* out)
+{
+  components_to_st12(rate, in, n, out, isa_detect());
+}
+
+void timecode_t::components_to_st12(const rate_t& rate, const components_t* in, size_t n, uint32_t* out, isa_t isa)
+{
+  isa = std::min(isa, isa_detect());
+#ifdef TIMECODE_X86
+  if (isa == isa_t::avx2) return st12_encode_avx2(in, n, out, rate.fps, rate.drop);
+  if (isa == isa_t::sse41) return st12_encode_sse41(in, n, out, rate.fps, rate.drop);
+#endif
+  for (size_t ii=0; ii < n; ++ii) out[ii] = st12_encode(in[ii], rate.fps, rate.drop);
+}
+
+void timecode_t::st12_to_components(const rate_t& rate, const uint32_t* in, size_t n, components_t* out)
+{
+  st12_to_components(rate, in, n, out, isa_detect());
+}
+
+void timecode_t::st12_to_components(const rate_t& rate, const uint32_t* in, size_t n, components_t* out, isa_t isa)
+{
+  isa = std::min(isa, isa_detect());
+#ifdef TIMECODE_X86
+  if (isa == isa_t::avx2) return st12_decode_avx2(in, n, out, rate.fps);
+  if (isa == isa_t::sse41) return st12_decode_sse41(in, n, out, rate.fps);
+#endif
+  for (size_t ii=0; ii < n; ++ii) out[ii] = st12_decode(in[ii], rate.fps);
 }
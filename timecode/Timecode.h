@@ -1,9 +1,108 @@
 #pragma once
 
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
 #include <cstdint>
+#include <iosfwd>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 
+namespace timecode_detail
+{
+
+/// Timecode components: day hour minutes seconds frames
+struct components_t
+{
+  uint16_t ff;
+  uint16_t ss;
+  uint16_t mm;
+  uint16_t hh;
+  uint64_t dd;
+};
+
+/// Frames per second, minute, etc. of a rate known at compile time: divisions by those compile to multiplications & shifts.
+template<uint64_t Fps, bool Drop>
+struct frames_per_c
+{
+  static_assert(Fps > 0, "a timecode rate needs at least 1 frame per second");
+
+  static constexpr uint64_t second = Fps;
+  static constexpr uint64_t minute = Fps*60;
+  static constexpr uint64_t hour = Fps*3600; //60*60
+  static constexpr uint64_t day = Fps*86400; //60*60*24
+  static constexpr uint64_t minute_real = Drop ? (60*Fps*1000) / 1001 : minute;
+  static constexpr uint64_t minute_dropped = minute - minute_real;
+  static constexpr uint64_t ten_minute = 10*minute_real + minute_dropped;
+};
+
+/// Frame count to components conversion, R providing the frames per second, minute, etc. (either frames_per_c or runtime values).
+/// The arithmetic is done on U: uint32_t may be used when frames < 2^31 and r.day <= UINT32_MAX / 2, which lets loops over arrays vectorize.
+template<typename U = uint64_t, typename R>
+constexpr void decompose(const R& r, U frames, components_t& d)
+{
+  if (r.minute_dropped)
+  {
+    // Count the number of 10 minutes time-spans comprised in this timecode.
+    const U ten_minutes_group_cnt = frames / static_cast<U>(r.ten_minute);
+    // Count remaining frames.
+    const U remaining_frames = frames % static_cast<U>(r.ten_minute);
+    // Count remaining minutes.
+    // Note: We remove minute_dropped from remaining_frames.
+    //       This is due to the fact that every 10 minute, one minute is longer than the others by minute_dropped frames.
+    const U remaining_minutes = (std::max(remaining_frames, static_cast<U>(r.minute_dropped)) - static_cast<U>(r.minute_dropped)) / static_cast<U>(r.minute_real);
+    // Restore dropped frames.
+    frames += static_cast<U>(r.minute_dropped) * (9 * ten_minutes_group_cnt + remaining_minutes);
+  }
+
+  d.dd = frames / static_cast<U>(r.day);
+  frames %= static_cast<U>(r.day);
+  d.hh = static_cast<uint16_t>(frames / static_cast<U>(r.hour));
+  frames %= static_cast<U>(r.hour);
+  d.mm = static_cast<uint16_t>(frames / static_cast<U>(r.minute));
+  frames %= static_cast<U>(r.minute);
+  d.ss = static_cast<uint16_t>(frames / static_cast<U>(r.second));
+  d.ff = static_cast<uint16_t>(frames % static_cast<U>(r.second));
+}
+
+/// Components to frame count conversion. The arithmetic is done on U: uint32_t may be used when d.dd is 0, d.hh < 40 (as any
+/// ST-12 word) and r.day <= UINT32_MAX / 2.
+template<typename U = uint64_t, typename R>
+constexpr U compose(const R& r, const components_t& d)
+{
+  U result = 0;
+
+  // May be updated depending on the drop-frame flag.
+  U frame = d.ff;
+
+  if (r.minute_dropped)
+  {
+    if (d.ss == 0 &&
+        frame < r.minute_dropped &&
+        (d.mm % 10) != 0)
+    {
+      // Except every ten minutes:
+      //  . 30DF: Frames 00, 01 and 02 are mapped to the same actual video frame.
+      //  . 60DF: Frames 00, 01, 02, 03 and 04 are mapped to the same actual video frame.
+      frame = static_cast<U>(r.minute_dropped);
+    }
+
+    // Compensate for each dropped frames per minute (except for the ones kept every ten minute).
+    // Note: the result wraps around for large day counts, as it always did.
+    const U minutes_count = static_cast<U>((d.dd * 1440) + (d.hh * 60) + d.mm);
+    result -= static_cast<U>(r.minute_dropped) * (minutes_count - minutes_count / 10);
+  }
+
+  // Add timecode withtout taking account of the drop value (which was compensated just before).
+  // Factorization from:
+  // result += frame + (sec * rate) + (min * 60 * rate) + (hour * 60 * 60 * rate) + (day * 60 * 60 * 24 * rate)
+  return result + frame + static_cast<U>(r.second) * static_cast<U>(d.ss + 60 * (d.mm + 60 * (d.hh + 24 * d.dd)));
+}
+
+} // timecode_detail
+
 /**
  * @brief This class represents a media timecode (e.g: 00:00:00:00) with a defined frame rate and a drop frame flag.
  * Based on the work at https://github.com/X3TechnologyGroup/VideoFrame/blob/master/VideoFrame.js#L41
@@ -14,7 +113,8 @@ public:
   /// A timecode rate embbeds the FPS and drop flag values
   struct rate_t
   {
-    inline rate_t(uint16_t f, bool d)
+    // constexpr: the RATE_ constants are constant-initialized, hence usable by the static initializers of other translation units
+    constexpr rate_t(uint16_t f, bool d)
       : fps{f}, drop{d} {}
     rate_t(const rate_t&)=default;
     rate_t(rate_t&&)=default;
@@ -100,6 +200,36 @@ public:
   /// @returns the SMPTE ST-12 32-bits word representing the current timecode
   uint32_t st12() const;
 
+  /// Day, hour, minute, second and frame counts
+  using components_t = timecode_detail::components_t;
+
+  /// @brief Batch conversions over arrays of n elements, e.g: to build the per-frame index of a recording.
+  /// Each is a single loop for the rate: the divisors of the built-in rates are constants and frame counts below 2^31 use 32-bit
+  /// arithmetic, which the compiler vectorizes. Arrays of at least a few 100k elements may be split across threads threads.
+  /// Results are those of set_framecount() then st12(), etc.
+  static void framecounts_to_st12(const rate_t& rate, const uint64_t* frames, size_t n, uint32_t* out, unsigned threads=1);
+  static void framecounts_to_components(const rate_t& rate, const uint64_t* frames, size_t n, components_t* out, unsigned threads=1);
+  static void st12_to_framecounts(const rate_t& rate, const uint32_t* st12, size_t n, uint64_t* out, unsigned threads=1);
+
+  /// Instruction sets of the bulk ST-12 kernels below, from the least to the most capable
+  enum class isa_t
+  {
+    scalar,
+    sse41, // 4 words per iteration
+    avx2,  // 8 words per iteration
+  };
+  /// @returns the most capable instruction set supported by the host CPU (detected once)
+  static isa_t isa_detect();
+
+  /// @brief Bulk ST-12 encoding / decoding of n timecodes, e.g: the VITC/LTC words of every line of many channels.
+  /// The BCD digits of several words are packed / unpacked at once, >30 FPS field bits included. Results are those of
+  /// st12() / set_st12(): blocks with components that don't fit ST-12 (>= 100) are encoded one by one.
+  static void components_to_st12(const rate_t& rate, const components_t* in, size_t n, uint32_t* out);
+  static void st12_to_components(const rate_t& rate, const uint32_t* in, size_t n, components_t* out);
+  /// Same as above, using at most the specified instruction set
+  static void components_to_st12(const rate_t& rate, const components_t* in, size_t n, uint32_t* out, isa_t isa);
+  static void st12_to_components(const rate_t& rate, const uint32_t* in, size_t n, components_t* out, isa_t isa);
+
   /**
    * @brief Sets the index of the last frame stored inside this Timecode.
    * Setting this member will update day, hours, minutes, seconds and frame members.
@@ -133,45 +263,241 @@ public:
   timecode_t& operator--(); // prefix
   timecode_t operator--(int) const; // postfix
   timecode_t& operator-=(int64_t);
+  /// Moves the timecode by n frames (n may be negative).
+  /// Moves within the current minute and single-frame steps (++/--) update the components in place with carries,
+  /// other moves go through the frame count.
+  timecode_t& advance(int64_t n);
   /// Returns the duration between 2 timecodes
-  timecode_t operator-(const Timecode&) const;
+  timecode_t operator-(const timecode_t&) const;
 
   /// @brief Gets this timecode as a string (e.g: 00:00:00:00 for NDF, 00:00:00;00 for DF).
   std::string str() const;
   /// @brief Sets this timecode as a string (e.g: 00:00:00:00 for NDF, 00:00:00;00 for DF).
-  timecode_t& set_str(const std::string&);
+  /// Only the beginning of the string is parsed, throws an error if it isn't a valid timecode.
+  timecode_t& set_str(std::string_view);
+
+  /// Maximum size of the string written by to_chars (the components of an invalid timecode may have up to 5 digits)
+  static constexpr size_t MAX_STR_SIZE = 4*5 + 3;
+  /// @brief Writes this timecode as str() into [first; last[, without allocating.
+  /// @returns the end of the written characters, or {last, std::errc::value_too_large} if the range is too small.
+  std::to_chars_result to_chars(char* first, char* last) const;
+  /// @brief Parses a timecode (HH:MM:SS:FF or HH:MM:SS;FF) at the beginning of [first; last[, without allocating.
+  /// @returns the end of the parsed characters and no error on success. On failure, this timecode is left unchanged and ec is
+  /// std::errc::invalid_argument if the characters don't match the pattern (ptr being first), std::errc::result_out_of_range
+  /// if a component is out of range for this rate.
+  std::from_chars_result from_chars(const char* first, const char* last);
 
   /// Conversion operator
   inline operator std::string() const { return str(); }
 
 private:
   // timecode data (day hour minutes seconds frames)
-  struct
-  {
-    uint16_t ff;
-    uint16_t ss;
-    uint16_t mm;
-    uint16_t hh;
-    uint64_t dd;
-  } _d = {0,0,0,0,0};
+  components_t _d = {0,0,0,0,0};
 
   // tc-rate
   rate_t _framerate = {0,false};
 
   // The goal of those members is to avoid un-necessary computations when asking for the frame count.
-  struct
+  // Only used for rates that are not built-in: conversions of the built-in rates use compile-time constants.
+  struct frames_per_t
   {
      uint64_t second;
      uint64_t minute;
      uint64_t hour;
      uint64_t day;
-     double minute_dropped;
-     double ten_minute;
+     uint64_t minute_dropped;
+     uint64_t ten_minute;
      uint64_t minute_real;
   } _frames_per;
 
   /// Updates values in the _frame_per struct
   void update_frames_per();
+
+  /// @returns true if the components d are valid for the current rate
+  bool is_valid(const components_t& d) const;
+  /// Parses the pattern HH:MM:SS[:;]FF at the beginning of [first; last[ into d, without range checks
+  static std::from_chars_result parse(const char* first, const char* last, components_t& d);
+
+  /// @returns true if d is the decomposition of a frame count (as set by decompose), which carry-based moves require
+  template<typename R> static bool canonical(const R& r, const components_t& d);
+  /// Carry-based ++, --, and moves by n frames
+  template<typename R> static void increment(const R& r, components_t& d);
+  template<typename R> static void decrement(const R& r, components_t& d);
+  template<typename R> static void advance(const R& r, components_t& d, int64_t n);
+  /// Calls f with the compile-time frames_per_t values of the current rate if it is built-in, with _frames_per otherwise
+  template<typename F> auto with_frames_per(F&& f) const;
 };
 
 std::ostream& operator<<(std::ostream& out, const timecode_t::rate_t& v);
+
+/**
+ * @brief A timecode whose rate is known at compile time, for channels with a fixed rate.
+ * It only holds a frame count (8 bytes): conversions to components are constexpr and divide by constants, and the arithmetic is the
+ * frame count's. It converts to and from timecode_t, for formatting and ST-12 words.
+ * e.g:
+ * constexpr timecode_ntsc_t tc{1, 0, 0, 0}; // 01:00:00;00
+ * static_assert(tc.framecount() == 107892);
+ */
+template<uint16_t Fps, bool Drop>
+class basic_timecode
+{
+public:
+  using frames_per = timecode_detail::frames_per_c<Fps, Drop>;
+  using components_t = timecode_detail::components_t;
+
+  static constexpr uint16_t fps = Fps;
+  static constexpr bool drop = Drop;
+
+  constexpr explicit basic_timecode(uint64_t frames=0)
+    : _frames{frames} {}
+  constexpr basic_timecode(uint16_t hh, uint16_t mm, uint16_t ss, uint16_t ff, uint64_t dd=0)
+    : _frames{timecode_detail::compose(frames_per{}, components_t{ff, ss, mm, hh, dd})} {}
+  /// Throws an error if the rate of tc is not this one
+  explicit basic_timecode(const timecode_t& tc)
+    : _frames{tc.framecount()}
+  {
+    if (!(tc.framerate() == framerate()))
+    {
+      throw std::runtime_error{"Timecode rate mismatch: " + std::to_string(tc.framerate().fps) + (tc.framerate().drop ? "DF" : "NDF") +
+                               " instead of " + std::to_string(Fps) + (Drop ? "DF" : "NDF")};
+    }
+  }
+  basic_timecode(const basic_timecode&)=default;
+  basic_timecode(basic_timecode&&)=default;
+  ~basic_timecode()=default;
+  basic_timecode& operator=(const basic_timecode&)=default;
+  basic_timecode& operator=(basic_timecode&&)=default;
+
+  /// Gets the timecode rate (fps & drop flag)
+  static inline timecode_t::rate_t framerate() { return timecode_t::rate_t{Fps, Drop}; }
+
+  /// Conversion operator
+  inline operator timecode_t() const { return timecode_t{framerate(), _frames}; }
+
+  /// Sets the index of the frame (00:00:00:00 being 0)
+  constexpr basic_timecode& set_framecount(uint64_t v) { _frames = v; return *this; }
+  /// Gets the index of the frame
+  constexpr uint64_t framecount() const { return _frames; }
+
+  /// @returns the day, hour, minute, second and frame counts
+  constexpr components_t components() const
+  {
+    components_t d{0,0,0,0,0};
+    timecode_detail::decompose(frames_per{}, _frames, d);
+    return d;
+  }
+  /// Gets the frame count
+  constexpr uint16_t ff() const { return components().ff; }
+  /// Gets the second count
+  constexpr uint16_t second() const { return components().ss; }
+  /// Gets the minute count
+  constexpr uint16_t mm() const { return components().mm; }
+  /// Gets the hour count
+  constexpr uint16_t hh() const { return components().hh; }
+  /// Gets the day count
+  constexpr uint64_t dd() const { return components().dd; }
+
+  /// @returns the SMPTE ST-12 32-bits word representing the current timecode
+  inline uint32_t st12() const { return timecode_t(*this).st12(); }
+  /// @brief Gets this timecode as a string (e.g: 00:00:00:00 for NDF, 00:00:00;00 for DF).
+  inline std::string str() const { return timecode_t(*this).str(); }
+
+  /// Comparison operators
+  constexpr bool operator<(const basic_timecode& o) const { return _frames < o._frames; }
+  constexpr bool operator>(const basic_timecode& o) const { return _frames > o._frames; }
+  constexpr bool operator<=(const basic_timecode& o) const { return _frames <= o._frames; }
+  constexpr bool operator>=(const basic_timecode& o) const { return _frames >= o._frames; }
+  constexpr bool operator==(const basic_timecode& o) const { return _frames == o._frames; }
+  constexpr bool operator!=(const basic_timecode& o) const { return _frames != o._frames; }
+
+  /// Increment operators
+  constexpr basic_timecode operator+(int64_t fc) const { return basic_timecode{_frames + static_cast<uint64_t>(fc)}; }
+  constexpr basic_timecode& operator++() { ++_frames; return *this; }
+  constexpr basic_timecode operator++(int) { basic_timecode r{*this}; ++_frames; return r; }
+  constexpr basic_timecode& operator+=(int64_t fc) { _frames += static_cast<uint64_t>(fc); return *this; }
+  /// Decrement operators
+  constexpr basic_timecode operator-(int64_t fc) const { return basic_timecode{_frames - static_cast<uint64_t>(fc)}; }
+  constexpr basic_timecode& operator--() { --_frames; return *this; }
+  constexpr basic_timecode operator--(int) { basic_timecode r{*this}; --_frames; return r; }
+  constexpr basic_timecode& operator-=(int64_t fc) { _frames -= static_cast<uint64_t>(fc); return *this; }
+  /// Returns the duration between 2 timecodes
+  constexpr basic_timecode operator-(const basic_timecode& o) const { return basic_timecode{_frames - o._frames}; }
+
+private:
+  uint64_t _frames;
+};
+
+/// Compile-time counterparts of the built-in rates
+using timecode_film_t = basic_timecode<24,false>;
+using timecode_pal_t = basic_timecode<25,false>;
+using timecode_pal_hs_t = basic_timecode<50,false>;
+using timecode_ntsc_t = basic_timecode<30,true>;
+using timecode_ntsc_hs_t = basic_timecode<60,true>;
+using timecode_web_t = basic_timecode<30,false>;
+using timecode_web_hs_t = basic_timecode<60,false>;
+
+/**
+ * @brief A timecode packed in 64 bits, for large in-memory indexes: the id of a built-in rate in the 8 MSB, the frame count in the 56 LSB.
+ * It is trivially copyable and 8 bytes large, against about 100 bytes for a timecode_t, and compares as an integer: timecodes
+ * of the same rate are ordered by frame count, timecodes of different rates by rate first.
+ * Components are only computed when asked for, with the constant-divisor conversions of basic_timecode.
+ */
+class packed_timecode
+{
+public:
+  /// Number of bits of the frame count
+  static constexpr unsigned FRAME_BITS = 56;
+  static constexpr uint64_t FRAME_MASK = (static_cast<uint64_t>(1) << FRAME_BITS) - 1;
+
+  /// 00:00:00:00 at 25 FPS NDF, as a default timecode_t
+  constexpr packed_timecode() = default;
+  /// Throws an error if the rate is not a built-in one, or if frames doesn't fit in FRAME_BITS
+  packed_timecode(const timecode_t::rate_t& framerate, uint64_t frames);
+  explicit packed_timecode(const timecode_t& tc)
+    : packed_timecode(tc.framerate(), tc.framecount()) {}
+  template<uint16_t Fps, bool Drop>
+  explicit packed_timecode(const basic_timecode<Fps, Drop>& tc)
+    : packed_timecode(tc.framerate(), tc.framecount()) {}
+
+  /// Instantiates a timecode from its 64 bits (as returned by raw())
+  static constexpr packed_timecode from_raw(uint64_t v) { packed_timecode r; r._v = v; return r; }
+  /// @returns the 64 bits of this timecode
+  constexpr uint64_t raw() const { return _v; }
+
+  /// Gets the timecode rate (fps & drop flag)
+  timecode_t::rate_t framerate() const;
+  /// Gets the index of the frame (00:00:00:00 being 0)
+  constexpr uint64_t framecount() const { return _v & FRAME_MASK; }
+
+  /// @returns the day, hour, minute, second and frame counts
+  timecode_detail::components_t components() const;
+  /// Gets the frame count
+  inline uint16_t ff() const { return components().ff; }
+  /// Gets the second count
+  inline uint16_t second() const { return components().ss; }
+  /// Gets the minute count
+  inline uint16_t mm() const { return components().mm; }
+  /// Gets the hour count
+  inline uint16_t hh() const { return components().hh; }
+  /// Gets the day count
+  inline uint64_t dd() const { return components().dd; }
+
+  /// Conversion operator
+  inline operator timecode_t() const { return timecode_t{framerate(), framecount()}; }
+  /// @brief Gets this timecode as a string (e.g: 00:00:00:00 for NDF, 00:00:00;00 for DF).
+  inline std::string str() const { return timecode_t(*this).str(); }
+
+  /// Comparison operators
+  constexpr bool operator<(const packed_timecode& o) const { return _v < o._v; }
+  constexpr bool operator>(const packed_timecode& o) const { return _v > o._v; }
+  constexpr bool operator<=(const packed_timecode& o) const { return _v <= o._v; }
+  constexpr bool operator>=(const packed_timecode& o) const { return _v >= o._v; }
+  constexpr bool operator==(const packed_timecode& o) const { return _v == o._v; }
+  constexpr bool operator!=(const packed_timecode& o) const { return _v != o._v; }
+
+private:
+  /// Rate id (the 8 MSB)
+  constexpr unsigned id() const { return static_cast<unsigned>(_v >> FRAME_BITS); }
+
+  uint64_t _v = 0;
+};
@@ -0,0 +1,342 @@
+#include "TimecodeIndex.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+/// Index file header (on-disk layout), followed by the segments and by the keys
+struct header_t
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t segments;
+  uint64_t frames;
+  uint64_t keys;
+};
+
+constexpr char MAGIC[8] = {'T','C','I','N','D','E','X','\0'};
+// 2: disjoint keys
+constexpr uint32_t VERSION = 2;
+
+static_assert(sizeof(header_t) == 40, "unexpected index header layout");
+static_assert(sizeof(timecode_index::segment_t) == 32, "unexpected index segment layout");
+static_assert(sizeof(timecode_index::key_t) == 24, "unexpected index key layout");
+
+/// @returns the number of frames of a day at rate
+uint64_t day_frames(const timecode_t::rate_t& rate)
+{
+  return timecode_t(rate).set_hh(24).framecount();
+}
+
+/// @returns the number of frames of a day at the rate of tc (computed once per packed rate)
+uint64_t day_frames(const packed_timecode& tc)
+{
+  constexpr unsigned RATES = 1u << (64 - packed_timecode::FRAME_BITS);
+  static const auto days = []()
+  {
+    std::array<uint64_t, RATES> r{};
+    for (unsigned id=0; id < RATES; ++id)
+    {
+      r[id] = day_frames(packed_timecode::from_raw(static_cast<uint64_t>(id) << packed_timecode::FRAME_BITS).framerate());
+    }
+    return r;
+  }();
+  return days[tc.raw() >> packed_timecode::FRAME_BITS];
+}
+
+/// @returns tc without its day count
+packed_timecode time_of_day(const packed_timecode& tc)
+{
+  return packed_timecode::from_raw(tc.raw() - tc.framecount() + tc.framecount() % day_frames(tc));
+}
+
+} // namespace
+
+timecode_index::timecode_index()
+  : timecode_index(timecode_index_writer{}.image())
+{
+}
+
+timecode_index::timecode_index(std::vector<uint8_t>&& image)
+  : _image(std::move(image))
+{
+  attach(_image.data(), _image.size());
+}
+
+timecode_index timecode_index::load(const std::string& path)
+{
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) throw std::runtime_error{"Failed to open " + path + " for reading: " + strerror(errno)};
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0)
+  {
+    const int err = errno;
+    ::close(fd);
+    throw std::runtime_error{"Failed to stat " + path + ": " + strerror(err)};
+  }
+  const size_t sz = static_cast<size_t>(st.st_size);
+  if (sz < sizeof(header_t))
+  {
+    ::close(fd);
+    throw std::runtime_error{"Invalid timecode index " + path + ": truncated header"};
+  }
+
+  void* p = ::mmap(nullptr, sz, PROT_READ, MAP_SHARED, fd, 0);
+  const int err = errno;
+  // the mapping keeps its own reference on the file
+  ::close(fd);
+  if (p == MAP_FAILED) throw std::runtime_error{"Failed to map " + path + ": " + strerror(err)};
+
+  timecode_index r;
+  r._image.clear();
+  r._mapped = true;
+  r._buf = static_cast<const uint8_t*>(p);
+  r._sz = sz;
+  try
+  {
+    r.attach(r._buf, r._sz);
+  }
+  catch (const std::exception& e)
+  {
+    throw std::runtime_error{"Invalid timecode index " + path + ": " + e.what()};
+  }
+  // lookups are binary searches: pages are read in random order
+  ::madvise(p, sz, MADV_RANDOM);
+  return r;
+}
+
+timecode_index::timecode_index(timecode_index&& o) noexcept
+  : _image(std::move(o._image)), _mapped(o._mapped), _buf(o._buf), _sz(o._sz), _n(o._n), _k(o._k), _segments(o._segments), _keys(o._keys)
+{
+  // moving a vector keeps its buffer: the pointers stay valid
+  o._mapped = false;
+  o._buf = nullptr;
+  o._sz = 0;
+  o._n = 0;
+  o._k = 0;
+}
+
+timecode_index& timecode_index::operator=(timecode_index&& o) noexcept
+{
+  if (this != &o)
+  {
+    unmap();
+    _image = std::move(o._image);
+    _mapped = o._mapped;
+    _buf = o._buf;
+    _sz = o._sz;
+    _n = o._n;
+    _k = o._k;
+    _segments = o._segments;
+    _keys = o._keys;
+    o._mapped = false;
+    o._buf = nullptr;
+    o._sz = 0;
+    o._n = 0;
+    o._k = 0;
+  }
+  return *this;
+}
+
+timecode_index::~timecode_index()
+{
+  unmap();
+}
+
+void timecode_index::unmap()
+{
+  if (_mapped && _buf) ::munmap(const_cast<uint8_t*>(_buf), _sz);
+  _mapped = false;
+  _buf = nullptr;
+}
+
+void timecode_index::attach(const uint8_t* buf, size_t sz)
+{
+  _buf = buf;
+  _sz = sz;
+  if (sz < sizeof(header_t)) throw std::runtime_error{"truncated header"};
+
+  const auto& h = *reinterpret_cast<const header_t*>(buf);
+  if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0) throw std::runtime_error{"bad magic"};
+  if (h.version != VERSION) throw std::runtime_error{"unsupported version " + std::to_string(h.version)};
+  if (h.segments > (sz - sizeof(header_t)) / sizeof(segment_t) || h.keys > (sz - sizeof(header_t)) / sizeof(key_t) ||
+      sz != sizeof(header_t) + h.segments * sizeof(segment_t) + h.keys * sizeof(key_t))
+  {
+    throw std::runtime_error{"size mismatch"};
+  }
+
+  _n = static_cast<size_t>(h.segments);
+  _k = static_cast<size_t>(h.keys);
+  _segments = reinterpret_cast<const segment_t*>(buf + sizeof(header_t));
+  _keys = reinterpret_cast<const key_t*>(buf + sizeof(header_t) + _n * sizeof(segment_t));
+  for (size_t ii=0; ii < _k; ++ii)
+  {
+    if (_keys[ii].segment >= _n) throw std::runtime_error{"key " + std::to_string(ii) + " out of range"};
+  }
+}
+
+uint64_t timecode_index::frames() const
+{
+  return _buf ? reinterpret_cast<const header_t*>(_buf)->frames : 0;
+}
+
+timecode_index::entry_t timecode_index::entry(const segment_t& s, uint64_t i) const
+{
+  return entry_t{s.position + i, s.offset + i * s.frame_size, s.frame_size, packed_timecode::from_raw(s.timecode + i)};
+}
+
+bool timecode_index::at(uint64_t position, entry_t& e) const
+{
+  // last segment starting at or before position
+  const segment_t* end = _segments + _n;
+  const segment_t* s = std::upper_bound(_segments, end, position, [](uint64_t p, const segment_t& v) { return p < v.position; });
+  if (s == _segments) return false;
+  --s;
+  if (position - s->position >= s->frames) return false;
+
+  e = entry(*s, position - s->position);
+  return true;
+}
+
+bool timecode_index::find(const packed_timecode& tc, entry_t& e) const
+{
+  const uint64_t raw = time_of_day(tc).raw();
+
+  // keys are disjoint: the last one starting at or before tc is the only one that may hold it
+  const key_t* k = std::upper_bound(_keys, _keys + _k, raw, [](uint64_t v, const key_t& key) { return v < key.begin; });
+  if (k == _keys || raw >= (--k)->end) return false;
+
+  const segment_t& s = _segments[k->segment];
+  e = entry(s, raw - s.timecode);
+  return true;
+}
+
+bool timecode_index::find(const timecode_t& tc, entry_t& e) const
+{
+  return find(packed_timecode(tc), e);
+}
+
+bool timecode_index::find(const timecode_t::rate_t& rate, uint64_t framecount, entry_t& e) const
+{
+  return find(packed_timecode(rate, framecount), e);
+}
+
+void timecode_index_writer::append(const timecode_t& tc, uint64_t offset, uint32_t size)
+{
+  append(packed_timecode(tc), offset, size);
+}
+
+void timecode_index_writer::append(const packed_timecode& tc, uint64_t offset, uint32_t size)
+{
+  const uint64_t raw = time_of_day(tc).raw();
+
+  if (!_segments.empty())
+  {
+    // a break point (jump, repeat, rate change, midnight wrap, change of size or gap in the data) starts a new segment
+    auto& s = _segments.back();
+    if (raw == s.timecode + s.frames && size == s.frame_size && offset == s.offset + static_cast<uint64_t>(s.frames) * s.frame_size &&
+        s.frames < UINT32_MAX)
+    {
+      ++s.frames;
+      ++_frames;
+      return;
+    }
+  }
+  _segments.push_back(timecode_index::segment_t{raw, _frames, offset, 1, size});
+  ++_frames;
+}
+
+std::vector<uint8_t> timecode_index_writer::image() const
+{
+  const size_t n = _segments.size();
+
+  // segments in timecode order
+  std::vector<size_t> order(n);
+  for (size_t ii=0; ii < n; ++ii) order[ii] = ii;
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return _segments[a].timecode < _segments[b].timecode; });
+
+  // boundaries of the disjoint runs
+  std::vector<uint64_t> bounds;
+  bounds.reserve(2 * n);
+  for (const auto& s : _segments)
+  {
+    bounds.push_back(s.timecode);
+    bounds.push_back(s.timecode + s.frames);
+  }
+  std::sort(bounds.begin(), bounds.end());
+  bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+  // sweep over the runs: the segments covering a run are the ones started and not ended yet, the first recorded one owning it
+  std::vector<timecode_index::key_t> keys;
+  std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> covering;
+  size_t next = 0;
+  for (size_t ii=0; ii + 1 < bounds.size(); ++ii)
+  {
+    const uint64_t begin = bounds[ii];
+    for (; next < n && _segments[order[next]].timecode == begin; ++next) covering.push(order[next]);
+    // ended segments are dropped lazily, once they reach the top
+    while (!covering.empty() && _segments[covering.top()].timecode + _segments[covering.top()].frames <= begin) covering.pop();
+    if (covering.empty()) continue;
+
+    const size_t s = covering.top();
+    if (!keys.empty() && keys.back().segment == s && keys.back().end == begin) keys.back().end = bounds[ii + 1];
+    else keys.push_back(timecode_index::key_t{begin, bounds[ii + 1], s});
+  }
+
+  header_t h{};
+  std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+  h.version = VERSION;
+  h.segments = n;
+  h.frames = _frames;
+  h.keys = keys.size();
+
+  std::vector<uint8_t> r(sizeof(h) + n * sizeof(timecode_index::segment_t) + keys.size() * sizeof(timecode_index::key_t));
+  uint8_t* p = r.data();
+  std::memcpy(p, &h, sizeof(h));
+  p += sizeof(h);
+  if (n == 0) return r;
+  std::memcpy(p, _segments.data(), n * sizeof(timecode_index::segment_t));
+  p += n * sizeof(timecode_index::segment_t);
+  std::memcpy(p, keys.data(), keys.size() * sizeof(timecode_index::key_t));
+  return r;
+}
+
+timecode_index timecode_index_writer::index() const
+{
+  return timecode_index{image()};
+}
+
+void timecode_index_writer::save(const std::string& path) const
+{
+  const auto r = image();
+  const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) throw std::runtime_error{"Failed to open " + path + " for writing: " + strerror(errno)};
+
+  for (size_t done = 0; done < r.size(); )
+  {
+    const ssize_t n = ::write(fd, r.data() + done, r.size() - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0)
+    {
+      const int err = errno;
+      ::close(fd);
+      throw std::runtime_error{"Failed to write " + path + ": " + strerror(err)};
+    }
+    done += static_cast<size_t>(n);
+  }
+  if (::close(fd) != 0) throw std::runtime_error{"Failed to write " + path + ": " + strerror(errno)};
+}
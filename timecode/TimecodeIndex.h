@@ -0,0 +1,162 @@
+#pragma once
+
+#include "Timecode.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Read-only index of a recording, mapping timecodes to the position and byte offset of frames.
+ * The recording is described as run-length segments of contiguous timecodes: a segment is a run of frames whose timecode is
+ * incremented by one frame and whose data follow each other with a constant size. A break point (jump, repeat, rate change,
+ * midnight wrap, change of frame size) starts a new segment, so a continuous capture of a day takes a single 32-byte entry.
+ * Timecodes are indexed as times of day (the day count is dropped): after midnight, 00:00:00:05 is found in the frames following it.
+ * Lookups are in O(log n), n being the number of segments: by position in the recording, or by timecode / frame count. The latter
+ * searches keys built by the writer: the timecodes covered by the segments, split into disjoint runs sorted by timecode, each run
+ * pointing to the segment that recorded it first (at most 2n - 1 keys). If the same timecode is recorded several times, the first
+ * occurrence is returned, whatever the number of segments recorded over it.
+ * The index is built by timecode_index_writer, and is stored in a compact binary file that is mapped back as is by load():
+ * the lookups read it in place, without parsing nor copy.
+ * Timecodes must have a rate supported by packed_timecode.
+ * e.g:
+ * timecode_index_writer w;
+ * for (...) w.append(tc, offset, size); // every frame of the recording, in order
+ * w.save("capture.tci");
+ * const auto index = timecode_index::load("capture.tci");
+ * timecode_index::entry_t e;
+ * if (index.find(timecode_t::from_string("10:00:00:00"), e)) seek(e.offset);
+ */
+class timecode_index
+{
+public:
+  /// A frame of the recording
+  struct entry_t
+  {
+    /// Index of the frame in the recording (the first frame being 0)
+    uint64_t position;
+    /// Offset of the data of the frame, in bytes
+    uint64_t offset;
+    /// Size of the data of the frame, in bytes
+    uint32_t size;
+    /// Timecode of the frame (time of day)
+    packed_timecode timecode;
+  };
+
+  /// A run of contiguous timecodes (on-disk layout)
+  struct segment_t
+  {
+    /// packed_timecode::raw() of the first frame
+    uint64_t timecode;
+    /// Position of the first frame in the recording
+    uint64_t position;
+    /// Offset of the data of the first frame, in bytes
+    uint64_t offset;
+    /// Number of frames
+    uint32_t frames;
+    /// Size of the data of every frame, in bytes
+    uint32_t frame_size;
+  };
+
+  /// A run of timecodes first recorded by a single segment, in timecode order (on-disk layout). Keys don't overlap.
+  struct key_t
+  {
+    /// packed_timecode::raw() of the first timecode of the run
+    uint64_t begin;
+    /// packed_timecode::raw() following the last timecode of the run
+    uint64_t end;
+    /// Index of the segment
+    uint64_t segment;
+  };
+
+  /// Empty index
+  timecode_index();
+  /// Maps the index file at path. Throws on failure, or if the file is not a valid index.
+  static timecode_index load(const std::string& path);
+
+  timecode_index(const timecode_index&) = delete;
+  timecode_index& operator=(const timecode_index&) = delete;
+  timecode_index(timecode_index&& o) noexcept;
+  timecode_index& operator=(timecode_index&& o) noexcept;
+  ~timecode_index();
+
+  /// @returns the number of frames of the recording
+  uint64_t frames() const;
+  /// @returns the number of segments
+  inline size_t segments() const { return _n; }
+  /// @returns the segment i (< segments()), in recording order
+  inline const segment_t& segment(size_t i) const { return _segments[i]; }
+  /// @returns the number of keys
+  inline size_t keys() const { return _k; }
+  /// @returns the key i (< keys()), in timecode order
+  inline const key_t& key(size_t i) const { return _keys[i]; }
+
+  /// Gets the frame at position (< frames()). @returns false if there is no such frame.
+  bool at(uint64_t position, entry_t& e) const;
+  /// Gets the first frame recorded with the timecode tc. @returns false if tc is not in the recording.
+  bool find(const packed_timecode& tc, entry_t& e) const;
+  /// Same as above, from a timecode_t (its day count is ignored)
+  bool find(const timecode_t& tc, entry_t& e) const;
+  /// Same as above, from the frame count of a timecode (its day count is ignored)
+  bool find(const timecode_t::rate_t& rate, uint64_t framecount, entry_t& e) const;
+
+  /// @returns the on-disk image of the index
+  inline const uint8_t* data() const { return _buf; }
+  /// @returns the size of the on-disk image of the index, in bytes
+  inline size_t size() const { return _sz; }
+
+private:
+  friend class timecode_index_writer;
+
+  /// Index over a copy of the on-disk image
+  explicit timecode_index(std::vector<uint8_t>&& image);
+  /// Checks the image and sets the pointers into it
+  void attach(const uint8_t* buf, size_t sz);
+  /// @returns the frame i of the segment s
+  entry_t entry(const segment_t& s, uint64_t i) const;
+  void unmap();
+
+  std::vector<uint8_t> _image;
+  bool _mapped = false;
+  const uint8_t* _buf = nullptr;
+  size_t _sz = 0;
+
+  size_t _n = 0;
+  size_t _k = 0;
+  const segment_t* _segments = nullptr;
+  const key_t* _keys = nullptr;
+};
+
+/**
+ * @brief Builds a timecode_index from the frames of a recording, appended in order.
+ */
+class timecode_index_writer
+{
+public:
+  timecode_index_writer() = default;
+
+  /// Appends the next frame of the recording, of size bytes at offset. Throws if the rate of tc is not supported by packed_timecode.
+  void append(const timecode_t& tc, uint64_t offset, uint32_t size);
+  /// Same as above, from a packed_timecode
+  void append(const packed_timecode& tc, uint64_t offset, uint32_t size);
+
+  /// @returns the number of frames appended
+  inline uint64_t frames() const { return _frames; }
+  /// @returns the number of segments so far
+  inline size_t segments() const { return _segments.size(); }
+
+  /// @returns the index of the frames appended so far
+  timecode_index index() const;
+  /// Writes the index of the frames appended so far to the file at path. Throws on failure.
+  void save(const std::string& path) const;
+
+private:
+  friend class timecode_index;
+
+  /// @returns the on-disk image of the index
+  std::vector<uint8_t> image() const;
+
+  std::vector<timecode_index::segment_t> _segments;
+  uint64_t _frames = 0;
+};
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "Timecode.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Fixed-size lock-free ring buffer, for a single producer thread and a single consumer thread.
+ * push() and pop() never block nor allocate: push() fails when the ring is full.
+ */
+template<typename T, size_t N>
+class spsc_ring
+{
+  static_assert(N > 0 && (N & (N - 1)) == 0, "the ring size must be a power of 2");
+
+public:
+  spsc_ring() = default;
+  spsc_ring(const spsc_ring&) = delete;
+  spsc_ring& operator=(const spsc_ring&) = delete;
+
+  /// Producer side: @returns false if the ring is full
+  inline bool push(const T& v)
+  {
+    const size_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) == N) return false;
+    _buf[head % N] = v;
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Consumer side: @returns false if the ring is empty
+  inline bool pop(T& v)
+  {
+    const size_t tail = _tail.load(std::memory_order_relaxed);
+    if (_head.load(std::memory_order_acquire) == tail) return false;
+    v = _buf[tail % N];
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// @returns the number of elements in the ring (a snapshot when called concurrently)
+  inline size_t size() const
+  {
+    return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+  }
+
+private:
+  // producer & consumer indices on their own cache lines
+  alignas(64) std::atomic<size_t> _head{0};
+  alignas(64) std::atomic<size_t> _tail{0};
+  alignas(64) T _buf[N];
+};
+
+/// A timecode discontinuity detected by timecode_tracker
+struct timecode_event_t
+{
+  enum class type_t : uint8_t
+  {
+    jump,       // the timecode isn't the one following the previous one
+    repeat,     // the timecode is the same as the previous one
+    drop_frame, // drop-frame violation: dropped frame number (e.g: 00:01:00;00 at 30DF), or drop flag that doesn't match the rate
+    invalid,    // invalid BCD digit or component out of range
+  };
+
+  type_t type;
+  /// Index of the frame in the stream (the first word pushed being 0)
+  uint64_t frame;
+  /// ST-12 word predicted for that frame (0 until the tracker is synchronized on a first valid word)
+  uint32_t expected;
+  /// ST-12 word received
+  uint32_t received;
+};
+
+/**
+ * @brief Flags the discontinuities of a continuous stream of SMPTE ST-12 words (e.g: the VITC/LTC of a channel) in real time.
+ * The producer thread pushes the word of every frame: it is compared to the previous word incremented by one frame with carries,
+ * in O(1) and without frame count conversions. Discontinuities are recorded in a lock-free ring of Events entries, drained by a
+ * monitoring thread with pop(). When the ring is full, new events are counted in lost() and discarded.
+ * The first valid word is the sync point: invalid words received before it are reported, but predict nothing.
+ * After a discontinuity, the tracker resynchronizes on the received timecode (invalid words excepted).
+ * Only the timecode bits of the words are compared: the flag bits (colour frame, binary group flags, field mark) may change from
+ * one frame to the next.
+ * e.g:
+ * timecode_tracker<> tracker(timecode_t::RATE_NTSC);
+ * tracker.push(word); // capture thread, every frame
+ * timecode_event_t e;
+ * while (tracker.pop(e)) log(e); // monitoring thread
+ */
+template<size_t Events = 256>
+class timecode_tracker
+{
+public:
+  explicit timecode_tracker(const timecode_t::rate_t& rate)
+    : _expected{rate}, _received{rate}
+  {
+    // dropped frame numbers at the beginning of most minutes: 2 at 30DF, 4 at 60DF
+    const uint64_t minute = rate.fps * 60ULL;
+    _dropped = rate.drop ? minute - (minute * 1000) / 1001 : 0;
+    _drop = rate.drop;
+
+    // hours, minutes, seconds & frames, and the frame LSB above 30 fps (as read by timecode_t::set_st12)
+    _timecode_bits = 0x3f7f7f3f | (rate.fps > 30 ? 1u << (rate.fps == 50 ? 7 : 23) : 0);
+  }
+  timecode_tracker(const timecode_tracker&) = delete;
+  timecode_tracker& operator=(const timecode_tracker&) = delete;
+
+  /// Producer side: checks the ST-12 word of the next frame.
+  /// @returns true if it is the expected one (always the case for the first valid word, unless it breaks the drop-frame rules)
+  bool push(uint32_t st12)
+  {
+    const uint64_t frame = _frames++;
+
+    // BCD units above 9 (the tens fields are too narrow to hold such digits)
+    if ((((st12 & 0x0f0f0f0f) + 0x06060606) & 0x10101010) || !_received.set_st12(st12).is_valid())
+    {
+      report(timecode_event_t::type_t::invalid, frame, _synced ? _expected.st12() : 0, st12);
+      if (_synced) ++_expected;
+      return false;
+    }
+
+    bool ok = true;
+    if (!drop_frame_valid(st12))
+    {
+      ok = report(timecode_event_t::type_t::drop_frame, frame, _synced ? _expected.st12() : 0, st12);
+    }
+    else if (!_synced) {}
+    else if ((st12 & _timecode_bits) == _previous)
+    {
+      ok = report(timecode_event_t::type_t::repeat, frame, _expected.st12(), st12);
+    }
+    else if (_received.ff() != _expected.ff() || _received.second() != _expected.second() ||
+             _received.mm() != _expected.mm() || _received.hh() != _expected.hh())
+    {
+      ok = report(timecode_event_t::type_t::jump, frame, _expected.st12(), st12);
+    }
+
+    if (!ok || !_synced) _expected = _received;
+    ++_expected;
+    _previous = st12 & _timecode_bits;
+    _synced = true;
+    return ok;
+  }
+
+  /// Consumer side: @returns false if there is no pending event
+  inline bool pop(timecode_event_t& e) { return _events.pop(e); }
+
+  /// @returns the number of events discarded because the ring was full
+  inline uint64_t lost() const { return _lost.load(std::memory_order_relaxed); }
+  /// Producer side: @returns the number of words pushed so far
+  inline uint64_t frames() const { return _frames; }
+  /// Producer side: @returns the timecode predicted for the next frame
+  inline const timecode_t& expected() const { return _expected; }
+
+private:
+  /// @returns false (the frame doesn't match), recording the event
+  inline bool report(timecode_event_t::type_t type, uint64_t frame, uint32_t expected, uint32_t received)
+  {
+    if (!_events.push(timecode_event_t{type, frame, expected, received})) _lost.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  /// @returns true if the drop flag of st12 matches the rate, and if its frame number isn't dropped
+  inline bool drop_frame_valid(uint32_t st12) const
+  {
+    if (!!(st12 & 1 << 30) != _drop) return false;
+    return !(_dropped && _received.second() == 0 && _received.ff() < _dropped && (_received.mm() % 10) != 0);
+  }
+
+  timecode_t _expected;
+  timecode_t _received;
+  uint64_t _dropped = 0;
+  bool _drop = false;
+  uint32_t _timecode_bits = 0;
+  bool _synced = false;
+  uint64_t _frames = 0;
+  uint32_t _previous = 0; // timecode bits of the previous valid word
+
+  spsc_ring<timecode_event_t, Events> _events;
+  std::atomic<uint64_t> _lost{0};
+};
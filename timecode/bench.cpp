@@ -0,0 +1,455 @@
+// Throughput of the timecode/ folder.
+// Build in Release and run e.g:
+//   timecode-bench --benchmark_out=timecode.json --benchmark_out_format=json
+// Every benchmark reports time_per_timecode (in seconds) so that releases can be compared.
+#include "Timecode.h"
+#include "TimecodeIndex.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <regex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+
+void set_counters(benchmark::State& state, size_t timecodes)
+{
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * timecodes));
+  state.counters["time_per_timecode"] = benchmark::Counter(static_cast<double>(timecodes), benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+}
+
+/// Frame counts of a whole day at 30DF, shuffled
+const std::vector<uint64_t>& day_frames()
+{
+  static std::vector<uint64_t> v;
+  if (v.empty())
+  {
+    v.resize(30 * 86400);
+    std::iota(v.begin(), v.end(), 0);
+    std::shuffle(v.begin(), v.end(), std::mt19937(42));
+  }
+  return v;
+}
+
+template<typename T> T make(uint64_t frames);
+template<> timecode_t make<timecode_t>(uint64_t frames) { return timecode_t{timecode_t::RATE_NTSC, frames}; }
+template<> packed_timecode make<packed_timecode>(uint64_t frames) { return packed_timecode{timecode_t::RATE_NTSC, frames}; }
+
+template<typename T>
+std::vector<T> make_index()
+{
+  std::vector<T> index;
+  index.reserve(day_frames().size());
+  for (auto f : day_frames()) index.push_back(make<T>(f));
+  return index;
+}
+
+/// timecode_t::str() as it used to be implemented, kept as a reference point
+std::string str_reference(const timecode_t& tc)
+{
+  auto pad = [](uint64_t n, size_t w, const std::string& c) -> std::string
+  {
+    auto result = std::to_string(n);
+    while (result.size() < w) result = c + result;
+    return result;
+  };
+
+  return pad(tc.hh()  ,2,"0") + ':' +
+         pad(tc.mm(),2,"0") + ':' +
+         pad(tc.second(),2,"0") + (tc.framerate().drop ? ';' : ':') +
+      pad(tc.ff() ,2,"0");
+}
+
+/// timecode_t::set_str() as it used to be implemented, kept as a reference point
+void set_str_reference(timecode_t& tc, const std::string& s)
+{
+  std::regex rx{"^([0-9]{2}):([0-9]{2}):([0-9]{2})(?::|;)([0-9]{2})"};
+  std::smatch m;
+  if (std::regex_search(s, m, rx))
+  {
+    tc.set_dd(0).set_hh(std::stoi(m[1])).set_mm(std::stoi(m[2])).set_ss(std::stoi(m[3])).set_ff(std::stoi(m[4]));
+    tc.verify();
+  }
+  else
+  {
+    throw std::runtime_error{"invalid format"};
+  }
+}
+
+/// Random timecodes (30DF) and their strings
+const std::vector<timecode_t>& random_timecodes()
+{
+  static std::vector<timecode_t> v;
+  if (v.empty())
+  {
+    std::mt19937_64 rng(42);
+    for (size_t ii=0; ii < 4096; ++ii) v.emplace_back(timecode_t::RATE_NTSC, rng() % (30 * 86400));
+  }
+  return v;
+}
+
+const std::vector<std::string>& random_strings()
+{
+  static std::vector<std::string> v;
+  if (v.empty())
+  {
+    for (const auto& tc : random_timecodes()) v.push_back(tc.str());
+  }
+  return v;
+}
+
+} // namespace
+
+// string conversions ---------------------------------------------------------
+
+static void timecode_str_reference(benchmark::State& state)
+{
+  for (auto _ : state)
+  {
+    for (const auto& tc : random_timecodes()) benchmark::DoNotOptimize(str_reference(tc));
+  }
+  set_counters(state, random_timecodes().size());
+}
+BENCHMARK(timecode_str_reference);
+
+static void timecode_str(benchmark::State& state)
+{
+  for (auto _ : state)
+  {
+    for (const auto& tc : random_timecodes()) benchmark::DoNotOptimize(tc.str());
+  }
+  set_counters(state, random_timecodes().size());
+}
+BENCHMARK(timecode_str);
+
+static void timecode_to_chars(benchmark::State& state)
+{
+  char buf[timecode_t::MAX_STR_SIZE];
+  for (auto _ : state)
+  {
+    for (const auto& tc : random_timecodes())
+    {
+      benchmark::DoNotOptimize(tc.to_chars(buf, buf + sizeof(buf)).ptr);
+      benchmark::ClobberMemory();
+    }
+  }
+  set_counters(state, random_timecodes().size());
+}
+BENCHMARK(timecode_to_chars);
+
+static void timecode_set_str_reference(benchmark::State& state)
+{
+  timecode_t tc{timecode_t::RATE_NTSC};
+  for (auto _ : state)
+  {
+    for (const auto& s : random_strings())
+    {
+      set_str_reference(tc, s);
+      benchmark::DoNotOptimize(tc);
+    }
+  }
+  set_counters(state, random_strings().size());
+}
+BENCHMARK(timecode_set_str_reference);
+
+static void timecode_set_str(benchmark::State& state)
+{
+  timecode_t tc{timecode_t::RATE_NTSC};
+  for (auto _ : state)
+  {
+    for (const auto& s : random_strings())
+    {
+      tc.set_str(s);
+      benchmark::DoNotOptimize(tc);
+    }
+  }
+  set_counters(state, random_strings().size());
+}
+BENCHMARK(timecode_set_str);
+
+static void timecode_from_chars(benchmark::State& state)
+{
+  timecode_t tc{timecode_t::RATE_NTSC};
+  for (auto _ : state)
+  {
+    for (const auto& s : random_strings())
+    {
+      benchmark::DoNotOptimize(tc.from_chars(s.data(), s.data() + s.size()).ptr);
+      benchmark::DoNotOptimize(tc);
+    }
+  }
+  set_counters(state, random_strings().size());
+}
+BENCHMARK(timecode_from_chars);
+
+// timecode_t vs packed_timecode ----------------------------------------------
+
+/// Builds a per-frame index of a day: reports the memory it takes
+template<typename T>
+static void timecode_index_build(benchmark::State& state)
+{
+  for (auto _ : state)
+  {
+    auto index = make_index<T>();
+    benchmark::DoNotOptimize(index.data());
+  }
+  set_counters(state, day_frames().size());
+  state.counters["bytes_per_timecode"] = static_cast<double>(sizeof(T));
+  state.counters["index_bytes"] = static_cast<double>(sizeof(T) * day_frames().size());
+}
+BENCHMARK_TEMPLATE(timecode_index_build, timecode_t)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(timecode_index_build, packed_timecode)->Unit(benchmark::kMillisecond);
+
+/// Sorts the shuffled index of a day
+template<typename T>
+static void timecode_index_sort(benchmark::State& state)
+{
+  const auto index = make_index<T>();
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    auto v = index;
+    state.ResumeTiming();
+    std::sort(v.begin(), v.end());
+    benchmark::DoNotOptimize(v.data());
+  }
+  set_counters(state, index.size());
+}
+BENCHMARK_TEMPLATE(timecode_index_sort, timecode_t)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(timecode_index_sort, packed_timecode)->Unit(benchmark::kMillisecond);
+
+/// Reads the components of every timecode of the index
+template<typename T>
+static void timecode_index_components(benchmark::State& state)
+{
+  const auto index = make_index<T>();
+  for (auto _ : state)
+  {
+    uint64_t sum = 0;
+    for (const auto& tc : index)
+    {
+      if constexpr (std::is_same<T, packed_timecode>::value)
+      {
+        const auto d = tc.components(); // decomposed on the fly
+        sum += d.hh + d.mm + d.ss + d.ff;
+      }
+      else sum += tc.hh() + tc.mm() + tc.second() + tc.ff();
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  set_counters(state, index.size());
+}
+BENCHMARK_TEMPLATE(timecode_index_components, timecode_t)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(timecode_index_components, packed_timecode)->Unit(benchmark::kMillisecond);
+
+// batch conversions ----------------------------------------------------------
+
+/// Per-frame index of a day at 30DF, one timecode_t at a time (reference point)
+static void framecounts_to_st12_reference(benchmark::State& state)
+{
+  std::vector<uint64_t> frames(30 * 86400);
+  std::iota(frames.begin(), frames.end(), 0);
+  std::vector<uint32_t> out(frames.size());
+  timecode_t tc{timecode_t::RATE_NTSC};
+  for (auto _ : state)
+  {
+    for (size_t ii=0; ii < frames.size(); ++ii) out[ii] = tc.set_framecount(frames[ii]).st12();
+    benchmark::DoNotOptimize(out.data());
+  }
+  set_counters(state, frames.size());
+}
+BENCHMARK(framecounts_to_st12_reference)->Unit(benchmark::kMillisecond);
+
+/// state.range(0) is the number of threads
+static void framecounts_to_st12(benchmark::State& state)
+{
+  std::vector<uint64_t> frames(30 * 86400);
+  std::iota(frames.begin(), frames.end(), 0);
+  std::vector<uint32_t> out(frames.size());
+  for (auto _ : state)
+  {
+    timecode_t::framecounts_to_st12(timecode_t::RATE_NTSC, frames.data(), frames.size(), out.data(), static_cast<unsigned>(state.range(0)));
+    benchmark::DoNotOptimize(out.data());
+  }
+  set_counters(state, frames.size());
+}
+BENCHMARK(framecounts_to_st12)->Arg(1)->Arg(4)->ArgName("threads")->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void framecounts_to_components(benchmark::State& state)
+{
+  std::vector<uint64_t> frames(30 * 86400);
+  std::iota(frames.begin(), frames.end(), 0);
+  std::vector<timecode_t::components_t> out(frames.size());
+  for (auto _ : state)
+  {
+    timecode_t::framecounts_to_components(timecode_t::RATE_NTSC, frames.data(), frames.size(), out.data(), static_cast<unsigned>(state.range(0)));
+    benchmark::DoNotOptimize(out.data());
+  }
+  set_counters(state, frames.size());
+}
+BENCHMARK(framecounts_to_components)->Arg(1)->Arg(4)->ArgName("threads")->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void st12_to_framecounts(benchmark::State& state)
+{
+  std::vector<uint64_t> frames(30 * 86400);
+  std::iota(frames.begin(), frames.end(), 0);
+  std::vector<uint32_t> st12(frames.size());
+  timecode_t::framecounts_to_st12(timecode_t::RATE_NTSC, frames.data(), frames.size(), st12.data());
+  for (auto _ : state)
+  {
+    timecode_t::st12_to_framecounts(timecode_t::RATE_NTSC, st12.data(), st12.size(), frames.data(), static_cast<unsigned>(state.range(0)));
+    benchmark::DoNotOptimize(frames.data());
+  }
+  set_counters(state, frames.size());
+}
+BENCHMARK(st12_to_framecounts)->Arg(1)->Arg(4)->ArgName("threads")->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// bulk ST-12 -----------------------------------------------------------------
+
+/// ST-12 words of 64k random timecodes at 60DF (field bits included)
+const std::vector<uint32_t>& random_st12()
+{
+  static std::vector<uint32_t> v;
+  if (v.empty())
+  {
+    std::mt19937_64 rng(42);
+    timecode_t tc{timecode_t::RATE_NTSC_HS};
+    for (size_t ii=0; ii < 65536; ++ii) v.push_back(tc.set_framecount(rng() % (60 * 86400)).st12());
+  }
+  return v;
+}
+
+static void st12_decode_reference(benchmark::State& state)
+{
+  const auto& words = random_st12();
+  std::vector<timecode_t::components_t> out(words.size());
+  timecode_t tc{timecode_t::RATE_NTSC_HS};
+  for (auto _ : state)
+  {
+    for (size_t ii=0; ii < words.size(); ++ii)
+    {
+      tc.set_st12(words[ii]);
+      out[ii] = timecode_t::components_t{tc.ff(), tc.second(), tc.mm(), tc.hh(), tc.dd()};
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+  set_counters(state, words.size());
+}
+BENCHMARK(st12_decode_reference);
+
+/// state.range(0) is the instruction set (timecode_t::isa_t)
+static void st12_to_components(benchmark::State& state)
+{
+  const auto& words = random_st12();
+  std::vector<timecode_t::components_t> out(words.size());
+  for (auto _ : state)
+  {
+    timecode_t::st12_to_components(timecode_t::RATE_NTSC_HS, words.data(), words.size(), out.data(), static_cast<timecode_t::isa_t>(state.range(0)));
+    benchmark::DoNotOptimize(out.data());
+  }
+  set_counters(state, words.size());
+}
+BENCHMARK(st12_to_components)->Arg(0)->Arg(1)->Arg(2)->ArgName("isa");
+
+static void st12_encode_reference(benchmark::State& state)
+{
+  const auto& words = random_st12();
+  std::vector<timecode_t::components_t> in(words.size());
+  timecode_t::st12_to_components(timecode_t::RATE_NTSC_HS, words.data(), words.size(), in.data());
+  std::vector<uint32_t> out(words.size());
+  timecode_t tc{timecode_t::RATE_NTSC_HS};
+  for (auto _ : state)
+  {
+    for (size_t ii=0; ii < in.size(); ++ii) out[ii] = tc.set_ff(in[ii].ff).set_ss(in[ii].ss).set_mm(in[ii].mm).set_hh(in[ii].hh).st12();
+    benchmark::DoNotOptimize(out.data());
+  }
+  set_counters(state, words.size());
+}
+BENCHMARK(st12_encode_reference);
+
+/// state.range(0) is the instruction set (timecode_t::isa_t)
+static void components_to_st12(benchmark::State& state)
+{
+  const auto& words = random_st12();
+  std::vector<timecode_t::components_t> in(words.size());
+  timecode_t::st12_to_components(timecode_t::RATE_NTSC_HS, words.data(), words.size(), in.data());
+  std::vector<uint32_t> out(words.size());
+  for (auto _ : state)
+  {
+    timecode_t::components_to_st12(timecode_t::RATE_NTSC_HS, in.data(), in.size(), out.data(), static_cast<timecode_t::isa_t>(state.range(0)));
+    benchmark::DoNotOptimize(out.data());
+  }
+  set_counters(state, words.size());
+}
+BENCHMARK(components_to_st12)->Arg(0)->Arg(1)->Arg(2)->ArgName("isa");
+
+/// An hour of recording at 30DF, with a jump every minute
+const std::vector<timecode_t>& recording()
+{
+  static std::vector<timecode_t> v;
+  if (v.empty())
+  {
+    std::mt19937 rng(42);
+    while (v.size() < 30 * 3600)
+    {
+      const uint64_t start = rng() % (30 * 86400);
+      for (uint64_t f = 0; f < 30 * 60; ++f) v.emplace_back(timecode_t::RATE_NTSC, start + f);
+    }
+  }
+  return v;
+}
+
+/// Timecodes of random frames of the recording
+std::vector<timecode_t> seek_targets()
+{
+  std::mt19937 rng(7);
+  std::vector<timecode_t> v;
+  for (size_t ii=0; ii < 100; ++ii) v.push_back(recording()[rng() % recording().size()]);
+  return v;
+}
+
+/// Seeks by timecode, scanning the timecodes of the recording (reference point)
+static void timecode_seek_linear(benchmark::State& state)
+{
+  const auto& rec = recording();
+  const auto targets = seek_targets();
+  for (auto _ : state)
+  {
+    for (const auto& tc : targets)
+    {
+      const auto it = std::find_if(rec.begin(), rec.end(), [&](const timecode_t& v) { return v.framecount() == tc.framecount(); });
+      benchmark::DoNotOptimize(it);
+    }
+  }
+  set_counters(state, targets.size());
+}
+BENCHMARK(timecode_seek_linear)->Unit(benchmark::kMicrosecond);
+
+/// Seeks by timecode with a timecode_index of the recording
+static void timecode_seek_index(benchmark::State& state)
+{
+  timecode_index_writer w;
+  for (size_t ii=0; ii < recording().size(); ++ii) w.append(recording()[ii], ii * 4096, 4096);
+  const auto index = w.index();
+  const auto targets = seek_targets();
+  timecode_index::entry_t e;
+  for (auto _ : state)
+  {
+    for (const auto& tc : targets)
+    {
+      benchmark::DoNotOptimize(index.find(tc, e));
+      benchmark::DoNotOptimize(e);
+    }
+  }
+  set_counters(state, targets.size());
+  state.counters["index_bytes"] = static_cast<double>(index.size());
+}
+BENCHMARK(timecode_seek_index)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -1,7 +1,12 @@
 #include <gtest/gtest.h>
 
-#include <timecode.h>
+#include "Timecode.h"
+
+#include <array>
+#include <iostream>
 #include <map>
+#include <numeric>
+#include <random>
 #include <vector>
 
 #include "test_Timecode_data.cxx"
@@ -31,7 +36,7 @@ TEST_P(TimecodeTest, loop)
   uint64_t fn=1700;
   for (const auto& s : ref)
   {
-    Timecode tc{GetParam(),fn};
+    timecode_t tc{GetParam(),fn};
     EXPECT_STREQ(tc.str().c_str(),s.c_str());
     EXPECT_EQ(tc.framecount(),fn);
     ++fn;
@@ -44,7 +49,7 @@ TEST_P(TimecodeTest, increment_decrement)
 {
   for (uint64_t fn=0; fn < TEST_COUNT; ++fn)
   {
-    Timecode tc{GetParam(), fn};
+    timecode_t tc{GetParam(), fn};
     ++tc;
     EXPECT_EQ(tc.framecount(),fn+1);
     --tc;
@@ -62,9 +67,9 @@ TEST_P(TimecodeTest, st12)
 {
   for (uint64_t fn=0; fn < TEST_COUNT; ++fn)
   {
-    Timecode tc{GetParam(), fn};
+    timecode_t tc{GetParam(), fn};
     uint32_t st12 = tc.st12();
-    Timecode tc2{GetParam(), 0};
+    timecode_t tc2{GetParam(), 0};
     tc2.set_st12(st12);
     EXPECT_EQ(tc.str(),tc2.str());
   }
@@ -72,7 +77,7 @@ TEST_P(TimecodeTest, st12)
 
 TEST_P(TimecodeTest, framecount)
 {
-  Timecode tc{GetParam()};
+  timecode_t tc{GetParam()};
   tc.set_framecount(0);
   EXPECT_EQ(tc.framecount(),0);
   EXPECT_STREQ(tc.str().c_str(),GetParam().drop ? "00:00:00;00" : "00:00:00:00");
@@ -93,7 +98,7 @@ TEST_P(TimecodeTest, framecount)
 TEST_P(TimecodeTest, overflow)
 {
   /// when the frame count exceeds a given value: the timecode  was overflowing. Leading to invalid values being stored.
-  Timecode tc(GetParam(),18446744071797000860ULL);
+  timecode_t tc(GetParam(),18446744071797000860ULL);
   EXPECT_LT(tc.ff(), 25);
   EXPECT_NE(tc.dd(), 0);
   std::cout << tc.dd() << "d " << tc.str() << std::endl;
@@ -106,11 +111,248 @@ TEST_P(TimecodeTest, drop_10m)
   for(size_t ii=0; ii<4; ++ii)
   {
     drop_10m_test_data_t data = DROP_10M_DATA[GetParam()][ii];
-    Timecode tc(GetParam());
+    timecode_t tc(GetParam());
     tc.set_framecount(data.frame_count);
     EXPECT_EQ(tc.framecount(), data.frame_count);
     EXPECT_EQ(tc.str(), data.str);
   }
 }
 
+/// Former floating-point implementation of set_framecount, used as a reference for the integer one
+static std::array<uint64_t,5> reference_components(const timecode_t::rate_t& rate, uint64_t frames)
+{
+  const uint64_t minute = rate.fps*60;
+  const uint64_t minute_real = static_cast<uint64_t>((60.*static_cast<double>(rate.fps)*1000.) / 1001.);
+  const double minute_dropped = 60.0 * static_cast<double>(rate.fps) - static_cast<double>(minute_real);
+  const double ten_minute = 10.0 * static_cast<double>(minute_real) + minute_dropped;
+
+  if (rate.drop)
+  {
+    const uint64_t ten_minutes_group_cnt = static_cast<uint64_t>(static_cast<long double>(frames) / static_cast<long double>(ten_minute));
+    const uint64_t remaining_frames = frames % static_cast<int64_t>(ten_minute);
+    const int64_t remaining_minutes = static_cast<int64_t>(static_cast<long double>(remaining_frames - minute_dropped) / static_cast<long double>(minute_real));
+    frames += static_cast<uint64_t>(minute_dropped) * (9 * ten_minutes_group_cnt + remaining_minutes);
+  }
+
+  const uint64_t dd = frames / (minute * 1440);
+  frames -= dd * minute * 1440;
+  const uint64_t hh = frames / (minute * 60);
+  frames -= hh * minute * 60;
+  const uint64_t mm = frames / minute;
+  frames -= mm * minute;
+  return {dd, hh, mm, frames / rate.fps, frames % rate.fps};
+}
+
+TEST_P(TimecodeTest, framecount_reference)
+{
+  // every frame of 2 days
+  timecode_t tc{GetParam()};
+  for (uint64_t fc=0; fc < GetParam().fps * 86400ULL * 2; ++fc)
+  {
+    tc.set_framecount(fc);
+    const auto ref = reference_components(GetParam(), fc);
+    ASSERT_EQ(tc.dd(), ref[0]) << fc;
+    ASSERT_EQ(tc.hh(), ref[1]) << fc;
+    ASSERT_EQ(tc.mm(), ref[2]) << fc;
+    ASSERT_EQ(tc.second(), ref[3]) << fc;
+    ASSERT_EQ(tc.ff(), ref[4]) << fc;
+    ASSERT_EQ(tc.framecount(), fc);
+  }
+}
+
+TEST_P(TimecodeTest, carry)
+{
+  // in place ++, -- and advance() against the frame count round trip, over every frame of 2 days
+  const uint64_t last = GetParam().fps * 86400ULL * 2;
+  timecode_t up{GetParam(), 0};
+  timecode_t down{GetParam(), last};
+  for (uint64_t fc=0; fc < last; ++fc)
+  {
+    ++up;
+    --down;
+    const timecode_t ref_up{GetParam(), fc + 1};
+    const timecode_t ref_down{GetParam(), last - fc - 1};
+    ASSERT_TRUE(up.ff() == ref_up.ff() && up.second() == ref_up.second() && up.mm() == ref_up.mm() && up.hh() == ref_up.hh() && up.dd() == ref_up.dd()) << fc;
+    ASSERT_TRUE(down.ff() == ref_down.ff() && down.second() == ref_down.second() && down.mm() == ref_down.mm() && down.hh() == ref_down.hh() && down.dd() == ref_down.dd()) << fc;
+
+    if (fc % 7) continue;
+    for (int64_t n : {-1000, -61, -2, 7, 59, 1001})
+    {
+      if (n < 0 && fc < static_cast<uint64_t>(-n)) continue; // drop-frame frame counts don't round trip past the wrap around
+      timecode_t tc{GetParam(), fc};
+      tc.advance(n);
+      ASSERT_EQ(tc.framecount(), fc + n) << fc << " " << n;
+    }
+  }
+
+  timecode_t zero{GetParam(), 0};
+  --zero;
+  EXPECT_EQ(zero.framecount(), timecode_t(GetParam(), UINT64_MAX).framecount());
+}
+
+static_assert(sizeof(timecode_pal_t) == 8, "basic_timecode only holds a frame count");
+static_assert(timecode_ntsc_t(1, 0, 0, 0).framecount() == 107892, "01:00:00;00 at 30DF");
+static_assert(timecode_ntsc_t(17982).mm() == 10, "00:10:00;00 at 30DF");
+
+template<typename T>
+static void test_basic_timecode()
+{
+  for (uint64_t fc=0; fc < T::fps * 86400ULL * 2; fc += 7)
+  {
+    const T b{fc};
+    const timecode_t tc{T::framerate(), fc};
+    ASSERT_TRUE(b.ff() == tc.ff() && b.second() == tc.second() && b.mm() == tc.mm() && b.hh() == tc.hh() && b.dd() == tc.dd()) << fc;
+    ASSERT_EQ(T(b.hh(), b.mm(), b.second(), b.ff(), b.dd()), b) << fc;
+    ASSERT_EQ(T{tc}, b) << fc;
+    ASSERT_EQ(static_cast<timecode_t>(b), tc) << fc;
+  }
+  EXPECT_THROW(T{timecode_t(timecode_t::rate_t{T::fps, !T::drop})}, std::runtime_error);
+}
+
+TEST(BasicTimecodeTest, timecode_t)
+{
+  test_basic_timecode<timecode_film_t>();
+  test_basic_timecode<timecode_pal_t>();
+  test_basic_timecode<timecode_pal_hs_t>();
+  test_basic_timecode<timecode_ntsc_t>();
+  test_basic_timecode<timecode_ntsc_hs_t>();
+  test_basic_timecode<timecode_web_t>();
+  test_basic_timecode<timecode_web_hs_t>();
+}
+
+TEST_P(TimecodeTest, packed)
+{
+  static_assert(sizeof(packed_timecode) == 8, "packed_timecode is a 64 bits value");
+
+  for (uint64_t fc=0; fc < GetParam().fps * 86400ULL * 2; fc += 7)
+  {
+    const timecode_t tc{GetParam(), fc};
+    const packed_timecode p{tc};
+    ASSERT_TRUE(p.framerate() == GetParam());
+    ASSERT_EQ(p.framecount(), fc);
+    ASSERT_TRUE(p.ff() == tc.ff() && p.second() == tc.second() && p.mm() == tc.mm() && p.hh() == tc.hh() && p.dd() == tc.dd()) << fc;
+    ASSERT_EQ(static_cast<timecode_t>(p), tc);
+    ASSERT_EQ(packed_timecode::from_raw(p.raw()), p);
+    ASSERT_LT(p, packed_timecode(GetParam(), fc + 1));
+  }
+
+  EXPECT_THROW(packed_timecode(GetParam(), packed_timecode::FRAME_MASK + 1), std::runtime_error);
+  EXPECT_THROW(packed_timecode(timecode_t::rate_t{48, false}, 0), std::runtime_error);
+}
+
+TEST_P(TimecodeTest, chars)
+{
+  char buf[timecode_t::MAX_STR_SIZE];
+  for (uint64_t fc=0; fc < TEST_COUNT; ++fc)
+  {
+    const timecode_t tc{GetParam(), fc};
+    const auto w = tc.to_chars(buf, buf + sizeof(buf));
+    ASSERT_EQ(w.ec, std::errc{});
+    ASSERT_EQ(std::string(buf, w.ptr), tc.str());
+
+    timecode_t tc2{GetParam()};
+    const auto r = tc2.from_chars(buf, w.ptr);
+    ASSERT_EQ(r.ec, std::errc{});
+    ASSERT_EQ(r.ptr, w.ptr);
+    ASSERT_EQ(tc2.framecount(), fc % (GetParam().fps * 86400ULL));
+  }
+
+  timecode_t tc{GetParam()};
+  EXPECT_EQ(tc.to_chars(buf, buf + 10).ec, std::errc::value_too_large);
+  tc.set_hh(123).set_ff(7);
+  const auto w = tc.to_chars(buf, buf + sizeof(buf));
+  EXPECT_EQ(std::string(buf, w.ptr), GetParam().drop ? "123:00:00;07" : "123:00:00:07");
+
+  const std::string invalid[] = {"", "00:00:00", "0:00:00:00", "00-00-00-00", "00:00:00:0x", "aa:00:00:00"};
+  for (const auto& s : invalid)
+  {
+    EXPECT_EQ(tc.from_chars(s.data(), s.data() + s.size()).ec, std::errc::invalid_argument) << s;
+    EXPECT_THROW(tc.set_str(s), std::runtime_error) << s;
+  }
+  const std::string out_of_range = "24:00:00:00";
+  EXPECT_EQ(tc.from_chars(out_of_range.data(), out_of_range.data() + out_of_range.size()).ec, std::errc::result_out_of_range);
+  EXPECT_EQ(tc.hh(), 123); // left unchanged
+  EXPECT_THROW(tc.set_str(out_of_range), std::runtime_error);
+
+  // trailing characters are ignored
+  EXPECT_EQ(timecode_t::from_string("01:02:03;04 trailing").framecount(), timecode_t(timecode_t::RATE_PAL).set_hh(1).set_mm(2).set_ss(3).set_ff(4).framecount());
+}
+
+TEST_P(TimecodeTest, batch)
+{
+  // 2 days, then large frame counts (64-bit path)
+  std::vector<uint64_t> frames(GetParam().fps * 86400ULL * 2);
+  std::iota(frames.begin(), frames.end(), 0);
+  for (uint64_t fc=1ULL << 31; fc < (1ULL << 31) + 1000; ++fc) frames.push_back(fc);
+  frames.push_back(1ULL << 40);
+  frames.push_back(UINT64_MAX / 2);
+
+  for (unsigned threads : {1u, 4u})
+  {
+    std::vector<uint32_t> st12(frames.size());
+    std::vector<timecode_t::components_t> components(frames.size());
+    std::vector<uint64_t> framecounts(frames.size());
+    timecode_t::framecounts_to_st12(GetParam(), frames.data(), frames.size(), st12.data(), threads);
+    timecode_t::framecounts_to_components(GetParam(), frames.data(), frames.size(), components.data(), threads);
+    timecode_t::st12_to_framecounts(GetParam(), st12.data(), st12.size(), framecounts.data(), threads);
+
+    timecode_t tc{GetParam()};
+    timecode_t tc2{GetParam()};
+    for (size_t ii=0; ii < frames.size(); ++ii)
+    {
+      tc.set_framecount(frames[ii]);
+      ASSERT_EQ(st12[ii], tc.st12()) << frames[ii];
+      const auto& d = components[ii];
+      ASSERT_TRUE(d.ff == tc.ff() && d.ss == tc.second() && d.mm == tc.mm() && d.hh == tc.hh() && d.dd == tc.dd()) << frames[ii];
+      ASSERT_EQ(framecounts[ii], tc2.set_st12(st12[ii]).framecount()) << frames[ii];
+    }
+  }
+}
+
+TEST_P(TimecodeTest, st12_bulk)
+{
+  // every frame of a day, then random words (invalid BCD digits included) and components that don't fit ST-12
+  const size_t day = GetParam().fps * 86400ULL;
+  std::vector<timecode_t::components_t> components(day);
+  std::vector<uint32_t> words(day);
+  timecode_t tc{GetParam()};
+  for (size_t ii=0; ii < day; ++ii)
+  {
+    tc.set_framecount(ii);
+    components[ii] = timecode_t::components_t{tc.ff(), tc.second(), tc.mm(), tc.hh(), 0};
+  }
+  std::mt19937 rng(GetParam().fps);
+  for (size_t ii=0; ii < 100000; ++ii)
+  {
+    words.push_back(static_cast<uint32_t>(rng()));
+    components.push_back(timecode_t::components_t{static_cast<uint16_t>(rng()), static_cast<uint16_t>(rng() % 128), static_cast<uint16_t>(rng() % 128), static_cast<uint16_t>(rng() % 128), 0});
+  }
+
+  for (auto isa : {timecode_t::isa_t::scalar, timecode_t::isa_t::sse41, timecode_t::isa_t::avx2})
+  {
+    std::vector<uint32_t> encoded(components.size());
+    timecode_t::components_to_st12(GetParam(), components.data(), components.size(), encoded.data(), isa);
+    for (size_t ii=0; ii < components.size(); ++ii)
+    {
+      const auto& d = components[ii];
+      ASSERT_EQ(encoded[ii], timecode_t(GetParam()).set_ff(d.ff).set_ss(d.ss).set_mm(d.mm).set_hh(d.hh).st12()) << ii;
+    }
+
+    // decoding the words of the day round trips
+    std::copy(encoded.begin(), encoded.begin() + day, words.begin());
+    std::vector<timecode_t::components_t> decoded(words.size());
+    timecode_t::st12_to_components(GetParam(), words.data(), words.size(), decoded.data(), isa);
+    for (size_t ii=0; ii < words.size(); ++ii)
+    {
+      tc.set_st12(words[ii]);
+      const auto& d = decoded[ii];
+      ASSERT_TRUE(d.ff == tc.ff() && d.ss == tc.second() && d.mm == tc.mm() && d.hh == tc.hh() && d.dd == 0) << std::hex << words[ii];
+      if (ii < day)
+      {
+        ASSERT_TRUE(d.ff == components[ii].ff && d.ss == components[ii].ss && d.mm == components[ii].mm && d.hh == components[ii].hh) << ii;
+      }
+    }
+  }
+}
+
 INSTANTIATE_TEST_CASE_P(Timecode, TimecodeTest, ::testing::ValuesIn(rates), print_test_name);
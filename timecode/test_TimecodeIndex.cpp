@@ -0,0 +1,235 @@
+#include <gtest/gtest.h>
+
+#include "TimecodeIndex.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+/// A recording: the timecode of every frame, in order
+struct frame_t
+{
+  timecode_t::rate_t rate;
+  uint64_t frames;
+};
+
+/// @returns the position of the first frame of rec with the timecode (rate, frames), or -1
+int64_t linear_find(const std::vector<frame_t>& rec, const timecode_t::rate_t& rate, uint64_t frames)
+{
+  for (size_t ii=0; ii < rec.size(); ++ii)
+  {
+    if (rec[ii].rate == rate && rec[ii].frames == frames) return static_cast<int64_t>(ii);
+  }
+  return -1;
+}
+
+} // namespace
+
+TEST(TimecodeIndexTest, segments)
+{
+  const auto rate = timecode_t::RATE_NTSC;
+  const uint64_t day = 2589408;
+  const uint32_t size = 1000;
+
+  // 10 s before midnight, then 10 s after it, a repeat, a jump back, a gap in the data, and a rate change
+  timecode_index_writer w;
+  uint64_t offset = 0;
+  const auto append = [&](const timecode_t::rate_t& r, uint64_t frames) { w.append(timecode_t{r, frames}, offset, size); offset += size; };
+  for (uint64_t f = day - 300; f < day + 300; ++f) append(rate, f);
+  append(rate, 299);
+  for (uint64_t f = 100; f < 200; ++f) append(rate, f);
+  offset += size;
+  for (uint64_t f = 200; f < 300; ++f) append(rate, f);
+  for (uint64_t f = 0; f < 25; ++f) append(timecode_t::RATE_PAL, f);
+
+  const auto index = w.index();
+  ASSERT_EQ(index.frames(), 826u);
+  ASSERT_EQ(index.segments(), 6u); // midnight, repeat, jump, gap, rate
+  // the runs first recorded before and after midnight, and the PAL one: the repeat, jump & gap are recorded over 00:00:00;00 - 00:00:09;29
+  ASSERT_EQ(index.keys(), 3u);
+  EXPECT_EQ(index.size(), 40u + 6 * 32 + 3 * 24);
+
+  timecode_index::entry_t e;
+  ASSERT_TRUE(index.at(0, e));
+  EXPECT_EQ(e.timecode, packed_timecode(rate, day - 300));
+  EXPECT_EQ(e.timecode.str(), "23:59:50;00");
+  ASSERT_TRUE(index.at(825, e));
+  EXPECT_EQ(e.timecode, packed_timecode(timecode_t::RATE_PAL, 24));
+  EXPECT_EQ(e.offset, 826u * size);
+  EXPECT_FALSE(index.at(826, e));
+
+  // after midnight, and the day count ignored
+  ASSERT_TRUE(index.find(timecode_t{rate, 5}, e));
+  EXPECT_EQ(e.position, 305u);
+  ASSERT_TRUE(index.find(timecode_t{rate, day + 5}, e));
+  EXPECT_EQ(e.position, 305u);
+  ASSERT_TRUE(index.find(rate, 2 * day + 5, e));
+  EXPECT_EQ(e.position, 305u);
+  // first occurrence of a timecode recorded 3 times
+  ASSERT_TRUE(index.find(timecode_t{rate, 150}, e));
+  EXPECT_EQ(e.position, 450u);
+  EXPECT_EQ(e.offset, 450u * size);
+  ASSERT_TRUE(index.find(timecode_t{rate, 250}, e));
+  EXPECT_EQ(e.position, 550u);
+  // same frame count, other rate
+  ASSERT_TRUE(index.find(timecode_t{timecode_t::RATE_PAL, 5}, e));
+  EXPECT_EQ(e.position, 806u);
+  EXPECT_EQ(e.offset, 807u * size);
+
+  EXPECT_FALSE(index.find(timecode_t{rate, 300}, e));
+  EXPECT_FALSE(index.find(timecode_t{rate, day - 301}, e));
+  EXPECT_FALSE(index.find(timecode_t{timecode_t::RATE_PAL, 25}, e));
+  EXPECT_FALSE(index.find(timecode_t{timecode_t::RATE_FILM, 5}, e));
+  EXPECT_THROW(index.find(timecode_t{timecode_t::rate_t{48, false}, 5}, e), std::runtime_error);
+}
+
+TEST(TimecodeIndexTest, random)
+{
+  // random jumps over a few minutes, at 2 rates, against a linear scan
+  std::mt19937_64 rng(42);
+  std::vector<frame_t> rec;
+  timecode_index_writer w;
+  const std::vector<timecode_t::rate_t> rates = {timecode_t::RATE_PAL, timecode_t::RATE_NTSC_HS};
+  while (rec.size() < 20000)
+  {
+    const auto& rate = rates[rng() % rates.size()];
+    const uint64_t start = rng() % 10000;
+    const uint64_t n = 1 + rng() % 500;
+    for (uint64_t f = start; f < start + n; ++f)
+    {
+      w.append(timecode_t{rate, f}, rec.size() * 100, 100);
+      rec.push_back(frame_t{rate, f});
+    }
+  }
+  const auto index = w.index();
+  ASSERT_EQ(index.frames(), rec.size());
+
+  timecode_index::entry_t e;
+  for (size_t ii=0; ii < rec.size(); ii += 7)
+  {
+    ASSERT_TRUE(index.at(ii, e));
+    ASSERT_EQ(e.timecode, packed_timecode(rec[ii].rate, rec[ii].frames));
+  }
+  for (const auto& rate : rates)
+  {
+    for (uint64_t f = 0; f < 10600; ++f)
+    {
+      const int64_t expected = linear_find(rec, rate, f);
+      ASSERT_EQ(index.find(rate, f, e), expected >= 0) << f;
+      if (expected < 0) continue;
+      ASSERT_EQ(e.position, static_cast<uint64_t>(expected)) << f;
+      ASSERT_EQ(e.offset, static_cast<uint64_t>(expected) * 100) << f;
+    }
+  }
+}
+
+TEST(TimecodeIndexTest, overlap)
+{
+  // a long segment, then many short ones recorded over it and after it: lookups stay binary searches over disjoint keys
+  const auto rate = timecode_t::RATE_PAL;
+  const uint64_t n = 200000, span = 2 * n;
+
+  timecode_index_writer w;
+  for (uint64_t f = 0; f < n; ++f) w.append(timecode_t{rate, f}, f, 1);
+  std::vector<int64_t> first(span, -1);
+  for (uint64_t ii = 0; ii < n; ++ii)
+  {
+    // jumps of 7919 frames: every frame is its own segment, and every timecode of [0; span[ is recorded once at most
+    const uint64_t f = (ii * 7919) % span;
+    w.append(timecode_t{rate, f}, n + ii, 1);
+    if (f >= n) first[f] = static_cast<int64_t>(n + ii);
+  }
+  for (uint64_t f = 0; f < n; ++f) first[f] = static_cast<int64_t>(f);
+
+  const auto index = w.index();
+  ASSERT_EQ(index.segments(), n + 1);
+
+  // keys are sorted and disjoint, at most 2n - 1 of them: find() visits log2(keys) + 1 of them at most
+  ASSERT_LE(index.keys(), 2 * index.segments() - 1);
+  // the long segment, and one key per short segment after it
+  EXPECT_EQ(index.keys(), 1 + static_cast<size_t>(std::count_if(first.begin() + n, first.end(), [](int64_t p) { return p >= 0; })));
+  for (size_t ii=0; ii < index.keys(); ++ii)
+  {
+    const auto& k = index.key(ii);
+    ASSERT_LT(k.begin, k.end) << ii;
+    ASSERT_LT(k.segment, index.segments()) << ii;
+    if (ii > 0)
+    {
+      ASSERT_LE(index.key(ii - 1).end, k.begin) << ii;
+    }
+  }
+  EXPECT_EQ(index.key(0).segment, 0u);
+  EXPECT_EQ(index.key(0).end - index.key(0).begin, n);
+
+  timecode_index::entry_t e;
+  for (uint64_t f = 0; f < span + 10; ++f)
+  {
+    const bool found = f < span && first[f] >= 0;
+    ASSERT_EQ(index.find(rate, f, e), found) << f;
+    if (found)
+    {
+      ASSERT_EQ(e.position, static_cast<uint64_t>(first[f])) << f;
+    }
+  }
+}
+
+TEST(TimecodeIndexTest, file)
+{
+  const std::string path = ::testing::TempDir() + "timecode_index_test.tci";
+
+  timecode_index_writer w;
+  for (uint64_t f = 0; f < 1000; ++f) w.append(timecode_t{timecode_t::RATE_PAL, f % 400}, f * 10, 10);
+  w.save(path);
+
+  {
+    auto index = timecode_index::load(path);
+    EXPECT_EQ(index.segments(), 3u);
+    const auto image = w.index();
+    ASSERT_EQ(index.size(), image.size());
+    EXPECT_EQ(memcmp(index.data(), image.data(), image.size()), 0);
+
+    // moved from a mapping
+    const auto moved = std::move(index);
+    timecode_index::entry_t e;
+    ASSERT_TRUE(moved.find(timecode_t{timecode_t::RATE_PAL, 399}, e));
+    EXPECT_EQ(e.position, 399u);
+    ASSERT_TRUE(moved.at(999, e));
+    EXPECT_EQ(e.timecode.framecount(), 199u);
+    EXPECT_EQ(index.frames(), 0u);
+  }
+
+  // empty
+  timecode_index_writer{}.save(path);
+  const auto empty = timecode_index::load(path);
+  timecode_index::entry_t e;
+  EXPECT_EQ(empty.frames(), 0u);
+  EXPECT_FALSE(empty.at(0, e));
+  EXPECT_FALSE(empty.find(timecode_t{}, e));
+
+  // truncated
+  {
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f << "TCINDEX";
+  }
+  EXPECT_THROW(timecode_index::load(path), std::runtime_error);
+  EXPECT_THROW(timecode_index::load(path + ".missing"), std::runtime_error);
+  // the errno of the failure is reported
+  try
+  {
+    w.save(::testing::TempDir() + "missing/timecode_index_test.tci");
+    FAIL() << "saved to a missing directory";
+  }
+  catch (const std::runtime_error& e)
+  {
+    EXPECT_NE(std::string(e.what()).find(strerror(ENOENT)), std::string::npos) << e.what();
+  }
+  std::remove(path.c_str());
+}
@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+
+#include "TimecodeTracker.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+std::vector<timecode_event_t> drain(timecode_tracker<>& t)
+{
+  std::vector<timecode_event_t> r;
+  timecode_event_t e;
+  while (t.pop(e)) r.push_back(e);
+  return r;
+}
+
+uint32_t st12(const timecode_t::rate_t& rate, uint64_t frames)
+{
+  return timecode_t(rate, frames).st12();
+}
+
+} // namespace
+
+TEST(TimecodeTrackerTest, continuous)
+{
+  // 2 days: midnight wrap, and every drop-frame minute
+  for (const auto& rate : {timecode_t::RATE_PAL, timecode_t::RATE_NTSC, timecode_t::RATE_NTSC_HS, timecode_t::RATE_PAL_HS})
+  {
+    timecode_tracker<> t(rate);
+    timecode_t tc{rate, 5 * 60 * static_cast<uint64_t>(rate.fps)};
+    for (uint64_t ii=0; ii < rate.fps * 86400ULL * 2; ++ii, ++tc)
+    {
+      ASSERT_TRUE(t.push(tc.st12())) << tc.str();
+    }
+    EXPECT_TRUE(drain(t).empty());
+  }
+}
+
+TEST(TimecodeTrackerTest, discontinuities)
+{
+  const auto rate = timecode_t::RATE_NTSC;
+  timecode_tracker<> t(rate);
+
+  EXPECT_TRUE(t.push(st12(rate, 100)));
+  EXPECT_TRUE(t.push(st12(rate, 101)));
+  EXPECT_FALSE(t.push(st12(rate, 101)));        // repeat
+  EXPECT_TRUE(t.push(st12(rate, 102)));
+  EXPECT_FALSE(t.push(st12(rate, 500)));        // jump
+  EXPECT_TRUE(t.push(st12(rate, 501)));         // resynchronized
+  EXPECT_FALSE(t.push(0x40000a00));             // invalid BCD
+  EXPECT_TRUE(t.push(st12(rate, 503)));         // a frame went by
+  EXPECT_FALSE(t.push(timecode_t(rate).set_mm(1).st12())); // 00:01:00;00 is dropped at 30DF
+  EXPECT_FALSE(t.push(st12(rate, 10) & ~(1 << 30)));       // drop flag missing
+
+  const auto events = drain(t);
+  ASSERT_EQ(events.size(), 5u);
+  EXPECT_EQ(events[0].type, timecode_event_t::type_t::repeat);
+  EXPECT_EQ(events[0].frame, 2u);
+  EXPECT_EQ(events[0].expected, st12(rate, 102));
+  EXPECT_EQ(events[1].type, timecode_event_t::type_t::jump);
+  EXPECT_EQ(events[1].frame, 4u);
+  EXPECT_EQ(events[1].expected, st12(rate, 103));
+  EXPECT_EQ(events[1].received, st12(rate, 500));
+  EXPECT_EQ(events[2].type, timecode_event_t::type_t::invalid);
+  EXPECT_EQ(events[3].type, timecode_event_t::type_t::drop_frame);
+  EXPECT_EQ(events[4].type, timecode_event_t::type_t::drop_frame);
+  EXPECT_EQ(t.lost(), 0u);
+}
+
+TEST(TimecodeTrackerTest, invalid_first)
+{
+  // the first valid word is the sync point: invalid words before it don't make it a jump
+  const auto rate = timecode_t::RATE_PAL;
+  timecode_tracker<> t(rate);
+
+  EXPECT_FALSE(t.push(0x0000000a));             // invalid BCD
+  EXPECT_FALSE(t.push(0x00000024));             // 24 hours
+  EXPECT_TRUE(t.push(st12(rate, 1000)));
+  EXPECT_TRUE(t.push(st12(rate, 1001)));
+  EXPECT_FALSE(t.push(0x0000000a));
+  EXPECT_TRUE(t.push(st12(rate, 1003)));        // a frame went by
+  EXPECT_EQ(t.frames(), 6u);
+
+  const auto events = drain(t);
+  ASSERT_EQ(events.size(), 3u);
+  for (size_t ii=0; ii < 3; ++ii) EXPECT_EQ(events[ii].type, timecode_event_t::type_t::invalid);
+  EXPECT_EQ(events[0].frame, 0u);
+  EXPECT_EQ(events[0].expected, 0u);
+  EXPECT_EQ(events[1].frame, 1u);
+  EXPECT_EQ(events[1].expected, 0u);
+  EXPECT_EQ(events[2].frame, 4u);
+  EXPECT_EQ(events[2].expected, st12(rate, 1002));
+}
+
+TEST(TimecodeTrackerTest, flags)
+{
+  // the colour frame & binary group flags (and the field mark at 30 fps or less) may change: only the timecode bits make a repeat
+  for (const auto& rate : {timecode_t::RATE_PAL, timecode_t::RATE_NTSC, timecode_t::RATE_PAL_HS, timecode_t::RATE_NTSC_HS})
+  {
+    const uint32_t flags = 1u << 31 | 1u << 15 | (rate.fps == 50 ? 1u << 6 : 3u << 6) | (rate.fps > 30 && rate.fps != 50 ? 0 : 1u << 23);
+    timecode_tracker<> t(rate);
+
+    for (uint64_t ii=0; ii < 1000; ++ii)
+    {
+      ASSERT_TRUE(t.push(st12(rate, 100 + ii) | (ii % 2 ? flags : 0))) << rate.fps << " fps, frame " << ii;
+    }
+    EXPECT_FALSE(t.push(st12(rate, 1099)));         // a repeat, flags aside
+    EXPECT_FALSE(t.push(st12(rate, 1099) | flags)); // again
+
+    const auto events = drain(t);
+    ASSERT_EQ(events.size(), 2u) << rate.fps << " fps";
+    EXPECT_EQ(events[0].type, timecode_event_t::type_t::repeat);
+    EXPECT_EQ(events[1].type, timecode_event_t::type_t::repeat);
+  }
+}
+
+TEST(TimecodeTrackerTest, full)
+{
+  timecode_tracker<4> t(timecode_t::RATE_PAL);
+  for (uint64_t ii=0; ii < 10; ++ii) t.push(st12(timecode_t::RATE_PAL, 0));
+  EXPECT_EQ(t.lost(), 5u); // 9 repeats
+}
+
+TEST(TimecodeTrackerTest, concurrent)
+{
+  // a jump every 7 frames, drained while pushing
+  const auto rate = timecode_t::RATE_PAL;
+  const uint64_t count = 1000000;
+  timecode_tracker<> t(rate);
+  std::atomic<bool> done{false};
+  std::vector<timecode_event_t> events;
+
+  std::thread monitor([&]()
+  {
+    timecode_event_t e;
+    while (!done.load())
+    {
+      while (t.pop(e)) events.push_back(e);
+      std::this_thread::yield();
+    }
+    while (t.pop(e)) events.push_back(e);
+  });
+  for (uint64_t ii=0; ii < count; ++ii)
+  {
+    t.push(st12(rate, ii % 7 == 6 ? ii + 1000 : ii));
+  }
+  done = true;
+  monitor.join();
+
+  ASSERT_EQ(events.size() + t.lost(), 2 * (count / 7)); // jump to ii + 1000, then back
+  for (size_t ii=1; ii < events.size(); ++ii) ASSERT_LT(events[ii - 1].frame, events[ii].frame);
+}
@@ -1,7 +1,8 @@
+#include <array>
 #include <map>
 #include <string>
 #include <vector>
-#include <timecode.h>
+#include "Timecode.h"
 
 // dataset generated with https://www.cinelexi.com/bulk-tc
 //  and https://bitbucket.evs.tv/projects/P2020/repos/frontend-player/raw/src/core/timecode.ts?at=refs%2Ftags%2F2.0.10